@@ -10,7 +10,9 @@
 #include <cassert>
 #include <memory>
 #include <ranges>
+#include <tl/enumerate.hpp>
 #include <tuple>
+#include <unordered_map>
 
 #include "duostra/duostra.hpp"
 #include "duostra/mapping_eqv_checker.hpp"
@@ -74,7 +76,10 @@ void Extractor::initialize(bool from_empty_qcir) {
     });
 
     update_neighbors();
-    for (auto& v : _graph->get_vertices()) {
+    _graph->update_gadget_index();
+    for (auto& v : _graph->get_gadget_leaves()) {
+        // the index only knows that the leaf has a single neighbor; the types, the edge and the phase
+        // of the axel still have to be checked
         if (_graph->is_gadget_leaf(v)) {
             _axels.emplace(_graph->get_first_neighbor(v).first);
         }
@@ -296,18 +301,8 @@ size_t Extractor::extract_hadamards_from_matrix(bool check) {
         update_matrix();
     }
 
-    std::unordered_map<size_t, ZXVertex*> frontier_id_to_vertex;
-    std::unordered_map<size_t, ZXVertex*> neighbor_id_to_vertex;
-    size_t cnt = 0;
-    for (auto& f : _frontier) {
-        frontier_id_to_vertex[cnt] = f;
-        cnt++;
-    }
-    cnt = 0;
-    for (auto& n : _neighbors) {
-        neighbor_id_to_vertex[cnt] = n;
-        cnt++;
-    }
+    std::vector<ZXVertex*> const frontier_vertices(_frontier.begin(), _frontier.end());
+    std::vector<ZXVertex*> const neighbor_vertices(_neighbors.begin(), _neighbors.end());
 
     // NOTE - Store pairs to be modified
     std::vector<std::pair<ZXVertex*, ZXVertex*>> front_neigh_pairs;
@@ -315,12 +310,8 @@ size_t Extractor::extract_hadamards_from_matrix(bool check) {
     for (size_t row = 0; row < _biadjacency.num_rows(); ++row) {
         if (!_biadjacency[row].is_one_hot()) continue;
 
-        for (size_t col = 0; col < _biadjacency.num_cols(); col++) {
-            if (_biadjacency[row][col] == 1) {
-                front_neigh_pairs.emplace_back(frontier_id_to_vertex[row], neighbor_id_to_vertex[col]);
-                break;
-            }
-        }
+        auto const col = _biadjacency[row].find_first_one();
+        front_neigh_pairs.emplace_back(frontier_vertices[row], neighbor_vertices[col]);
     }
 
     for (auto& [f, n] : front_neigh_pairs) {
@@ -403,6 +394,9 @@ bool Extractor::remove_gadget(bool check) {
             }
         }
     }
+    // the pivots rewire the neighborhoods of the frontier
+    if (removed_some_gadgets) _biadjacency_cache.is_valid = false;
+
     _graph->print_vertices(spdlog::level::level_enum::trace);
     print_frontier(spdlog::level::level_enum::debug);
     print_axels(spdlog::level::level_enum::debug);
@@ -427,11 +421,9 @@ void Extractor::column_optimal_swap() {
     _col_info.resize(col_cnt);
 
     for (size_t i = 0; i < row_cnt; i++) {
-        for (size_t j = 0; j < col_cnt; j++) {
-            if (_biadjacency[i][j] == 1) {
-                _row_info[i].emplace(j);
-                _col_info[j].emplace(i);
-            }
+        for (auto j = _biadjacency[i].find_first_one(); j < col_cnt; j = _biadjacency[i].find_first_one(j + 1)) {
+            _row_info[i].emplace(j);
+            _col_info[j].emplace(i);
         }
     }
 
@@ -808,24 +800,27 @@ void Extractor::update_neighbors() {
 }
 
 /**
- * @brief Update graph according to bi-adjacency matrix
+ * @brief Update graph according to bi-adjacency matrix. Only the entries that differ from the graph are visited.
  *
  * @param et EdgeType, default: EdgeType::HADAMARD
  */
 void Extractor::update_graph_by_matrix(EdgeType et) {
-    size_t r = 0;
     spdlog::debug("Updating graph by matrix");
-    for (auto& f : _frontier) {
-        size_t c = 0;
-        for (auto& nb : _neighbors) {
+    _sync_biadjacency_cache();
+    auto& matrix_in_graph = _biadjacency_cache.matrix;
+
+    std::vector<ZXVertex*> const neighbor_vertices(_neighbors.begin(), _neighbors.end());
+    for (auto const& [r, f] : tl::views::enumerate(_frontier)) {
+        auto const diff = _biadjacency[r] + matrix_in_graph[r];
+        for (auto c = diff.find_first_one(); c < diff.size(); c = diff.find_first_one(c + 1)) {
+            auto const nb = neighbor_vertices[c];
             if (_biadjacency[r][c] == 1 && !_graph->is_neighbor(nb, f, et)) {  // NOTE - Should connect but not connected
                 _graph->add_edge(f, nb, et);
             } else if (_biadjacency[r][c] == 0 && _graph->is_neighbor(nb, f, et)) {  // NOTE - Should not connect but connected
                 _graph->remove_edge(f, nb, et);
             }
-            c++;
+            matrix_in_graph[r][c] = _graph->is_neighbor(nb, f);
         }
-        r++;
     }
 }
 
@@ -834,7 +829,81 @@ void Extractor::update_graph_by_matrix(EdgeType et) {
  *
  */
 void Extractor::update_matrix() {
-    _biadjacency = get_biadjacency_matrix(*_graph, _frontier, _neighbors);
+    _sync_biadjacency_cache();
+    _biadjacency = _biadjacency_cache.matrix;
+}
+
+/**
+ * @brief Bring the bi-adjacency matrix cache up to date with the frontier and the neighbors. The rows and
+ *        the columns of the vertices already in the cache are carried over. Their connections only change
+ *        in `update_graph_by_matrix`, which updates the cache, and in `remove_gadget`, which invalidates it.
+ *
+ */
+void Extractor::_sync_biadjacency_cache() {
+    auto& cache        = _biadjacency_cache;
+    auto const get_ids = [](ZXVertexList const& vertices) {
+        std::vector<size_t> ids;
+        ids.reserve(vertices.size());
+        for (auto const& v : vertices) ids.emplace_back(v->get_id());
+        return ids;
+    };
+    auto row_ids = get_ids(_frontier);
+    auto col_ids = get_ids(_neighbors);
+    if (cache.is_valid && row_ids == cache.row_ids && col_ids == cache.col_ids) return;
+
+    if (!cache.is_valid) {
+        cache.matrix   = get_biadjacency_matrix(*_graph, _frontier, _neighbors);
+        cache.row_ids  = std::move(row_ids);
+        cache.col_ids  = std::move(col_ids);
+        cache.is_valid = true;
+        return;
+    }
+
+    std::unordered_map<size_t, size_t> old_row_of, new_row_of, new_col_of;
+    for (auto const& [i, id] : tl::views::enumerate(cache.row_ids)) old_row_of.emplace(id, i);
+    for (auto const& [i, id] : tl::views::enumerate(row_ids)) new_row_of.emplace(id, i);
+    for (auto const& [j, id] : tl::views::enumerate(col_ids)) new_col_of.emplace(id, j);
+
+    // the new index of each old column, or SIZE_MAX if it is no longer a neighbor
+    std::vector<size_t> new_col_of_old(cache.col_ids.size(), SIZE_MAX);
+    std::vector<bool> is_new_col(col_ids.size(), true);
+    for (auto const& [old_j, id] : tl::views::enumerate(cache.col_ids)) {
+        if (auto const it = new_col_of.find(id); it != new_col_of.end()) {
+            new_col_of_old[old_j]  = it->second;
+            is_new_col[it->second] = false;
+        }
+    }
+    auto const is_same_cols = col_ids == cache.col_ids;
+
+    dvlab::BooleanMatrix matrix(row_ids.size(), col_ids.size());
+    for (auto const& [i, f] : tl::views::enumerate(_frontier)) {
+        auto const it = old_row_of.find(f->get_id());
+        if (it == old_row_of.end()) {
+            for (auto const& [nb, _] : _graph->get_neighbors(f)) {
+                if (auto const jt = new_col_of.find(nb->get_id()); jt != new_col_of.end()) matrix[i][jt->second] = 1;
+            }
+            continue;
+        }
+        auto const& old_row = cache.matrix[it->second];
+        if (is_same_cols) {
+            matrix[i] = old_row;
+            continue;
+        }
+        for (auto old_j = old_row.find_first_one(); old_j < old_row.size(); old_j = old_row.find_first_one(old_j + 1)) {
+            if (new_col_of_old[old_j] != SIZE_MAX) matrix[i][new_col_of_old[old_j]] = 1;
+        }
+    }
+    // the carried-over rows may be connected to the new columns, e.g., the buffers added in `update_neighbors`
+    for (auto const& [j, n] : tl::views::enumerate(_neighbors)) {
+        if (!is_new_col[j]) continue;
+        for (auto const& [nb, _] : _graph->get_neighbors(n)) {
+            if (auto const it = new_row_of.find(nb->get_id()); it != new_row_of.end()) matrix[it->second][j] = 1;
+        }
+    }
+
+    cache.matrix  = std::move(matrix);
+    cache.row_ids = std::move(row_ids);
+    cache.col_ids = std::move(col_ids);
 }
 
 /**
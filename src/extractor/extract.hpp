@@ -96,6 +96,18 @@ private:
     dvlab::BooleanMatrix _biadjacency;
     std::vector<dvlab::BooleanMatrix::RowOperation> _cnots;
 
+    // the bi-adjacency matrix of the frontier and the neighbors as they are connected in the graph.
+    // It is kept across the iterations and only the rows and columns of the vertices new to the
+    // frontier or the neighbors are read from the graph. Keyed by the vertex ids, which are never reused
+    struct BiadjacencyCache {
+        bool is_valid = false;
+        dvlab::BooleanMatrix matrix;
+        std::vector<size_t> row_ids;
+        std::vector<size_t> col_ids;
+    };
+    BiadjacencyCache _biadjacency_cache;
+    void _sync_biadjacency_cache();
+
     void _block_elimination(dvlab::BooleanMatrix& matrix, size_t& min_n_cxs, size_t block_size);
     void _block_elimination(size_t& best_block, dvlab::BooleanMatrix& best_matrix, size_t& min_cost, size_t block_size);
     void _filter_duplicate_cxs();
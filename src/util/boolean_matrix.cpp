@@ -7,30 +7,67 @@
 
 #include "./boolean_matrix.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cmath>
 #include <gsl/util>
+#include <numeric>
+#include <string>
 #include <tl/enumerate.hpp>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "fmt/core.h"
 #include "util/util.hpp"
 
 namespace dvlab {
 
-struct UCharVectorHash {
-    size_t operator()(std::vector<unsigned char> const& k) const {
-        size_t ret = std::hash<unsigned char>()(k[0]);
-        for (size_t i = 1; i < k.size(); i++) {
-            ret ^= std::hash<unsigned char>()(k[i] << (i % sizeof(size_t)));
+struct RowHash {
+    size_t operator()(BooleanMatrix::Row const& k) const {
+        size_t ret = k.size();
+        for (auto const& word : k.get_words()) {
+            ret ^= std::hash<BooleanMatrix::Row::Word>()(word) + 0x9e3779b97f4a7c15 + (ret << 6) + (ret >> 2);
         }
 
         return ret;
     }
 };
 
+BooleanMatrix::Row::Row(std::vector<unsigned char> const& r) : Row(r.size()) {
+    for (size_t i = 0; i < r.size(); ++i) {
+        if (r[i] & 1) _words[i / word_size] |= Word{1} << (i % word_size);
+    }
+}
+
+BooleanMatrix::Row::Row(size_t size, unsigned char val) : _words(_num_words(size), (val & 1) ? ~Word{0} : Word{0}), _size(size) {
+    _clear_padding();
+}
+
+/**
+ * @brief Zero the bits past the last entry, so that the words can be compared and counted as a whole
+ *
+ */
+void BooleanMatrix::Row::_clear_padding() {
+    if (_size % word_size != 0) _words.back() &= (Word{1} << (_size % word_size)) - 1;
+}
+
+/**
+ * @brief Append an entry
+ *
+ * @param i
+ */
+void BooleanMatrix::Row::emplace_back(unsigned char i) {
+    if (_size % word_size == 0) _words.emplace_back(0);
+    ++_size;
+    (*this)[_size - 1] = i;
+}
+
 /**
  * @brief Overload operator + for Row
  *
@@ -50,9 +87,19 @@ BooleanMatrix::Row operator+(BooleanMatrix::Row lhs, BooleanMatrix::Row const& r
  * @return Row&
  */
 BooleanMatrix::Row& BooleanMatrix::Row::operator+=(Row const& rhs) {
-    assert(_row.size() == rhs._row.size());
-    for (size_t i = 0; i < _row.size(); i++) {
-        _row[i] = (_row[i] + rhs._row[i]) % 2;
+    assert(_size == rhs._size);
+    auto* const words           = _words.data();
+    auto const* const rhs_words = rhs._words.data();
+    size_t i                    = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= _words.size(); i += 4) {
+        auto const lhs_block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i));
+        auto const rhs_block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rhs_words + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), _mm256_xor_si256(lhs_block, rhs_block));
+    }
+#endif
+    for (; i < _words.size(); i++) {
+        words[i] ^= rhs_words[i];
     }
     return *this;
 }
@@ -62,7 +109,13 @@ BooleanMatrix::Row& BooleanMatrix::Row::operator+=(Row const& rhs) {
  *
  */
 void BooleanMatrix::Row::print_row(spdlog::level::level_enum lvl) const {
-    spdlog::log(lvl, "{}", fmt::join(_row, " "));
+    std::string str;
+    str.reserve(2 * _size);
+    for (size_t i = 0; i < _size; i++) {
+        if (i > 0) str += ' ';
+        str += (*this)[i] ? '1' : '0';
+    }
+    spdlog::log(lvl, "{}", str);
 }
 
 /**
@@ -72,10 +125,14 @@ void BooleanMatrix::Row::print_row(spdlog::level::level_enum lvl) const {
  * @return false
  */
 bool BooleanMatrix::Row::is_one_hot() const {
-    // we don't use count_if here because we want to stop early if we find a second 1
-    auto first_one = std::ranges::find(_row, 1);
-    if (first_one == _row.end()) return false;
-    return std::ranges::find(first_one + 1, _row.end(), 1) == _row.end();
+    // we don't count all the 1s here because we want to stop early if we find a second 1
+    bool found_one = false;
+    for (auto const& word : _words) {
+        if (word == 0) continue;
+        if (found_one || !std::has_single_bit(word)) return false;
+        found_one = true;
+    }
+    return found_one;
 }
 
 /**
@@ -85,12 +142,61 @@ bool BooleanMatrix::Row::is_one_hot() const {
  * @return false
  */
 bool BooleanMatrix::Row::is_zeros() const {
-    for (auto& i : _row) {
-        if (i == 1) {
-            return false;
-        }
+    return std::ranges::all_of(_words, [](Word word) { return word == 0; });
+}
+
+/**
+ * @brief Find the first 1 at or after `pos`
+ *
+ * @param pos
+ * @return the index of the 1, or size() if there is none
+ */
+size_t BooleanMatrix::Row::find_first_one(size_t pos) const {
+    if (pos >= _size) return _size;
+    auto word_idx = pos / word_size;
+    auto word     = _words[word_idx] & (~Word{0} << (pos % word_size));
+    while (word == 0) {
+        if (++word_idx == _words.size()) return _size;
+        word = _words[word_idx];
     }
-    return true;
+    return word_idx * word_size + static_cast<size_t>(std::countr_zero(word));
+}
+
+/**
+ * @brief Get the entries in [begin, end) as a row
+ *
+ * @param begin
+ * @param end
+ * @return Row
+ */
+BooleanMatrix::Row BooleanMatrix::Row::slice(size_t begin, size_t end) const {
+    assert(begin <= end && end <= _size);
+    Row result(end - begin);
+    auto const shift = begin % word_size;
+    for (size_t i = 0; i < result._words.size(); i++) {
+        auto const word_idx = begin / word_size + i;
+        result._words[i]    = _words[word_idx] >> shift;
+        if (shift != 0 && word_idx + 1 < _words.size()) result._words[i] |= _words[word_idx + 1] << (word_size - shift);
+    }
+    result._clear_padding();
+    return result;
+}
+
+/**
+ * @brief Get the entries in [begin, end) as the low bits of a word
+ *
+ * @param begin
+ * @param end should be no more than `word_size` past `begin`
+ * @return Word
+ */
+BooleanMatrix::Row::Word BooleanMatrix::Row::get_bits(size_t begin, size_t end) const {
+    assert(begin <= end && end <= _size && end - begin <= word_size);
+    if (begin == end) return 0;
+    auto const word_idx = begin / word_size;
+    auto const shift    = begin % word_size;
+    auto bits           = _words[word_idx] >> shift;
+    if (shift != 0 && word_idx + 1 < _words.size()) bits |= _words[word_idx + 1] << (word_size - shift);
+    return end - begin == word_size ? bits : bits & ((Word{1} << (end - begin)) - 1);
 }
 
 /**
@@ -99,13 +205,9 @@ bool BooleanMatrix::Row::is_zeros() const {
  * @return Sum of the row
  */
 size_t BooleanMatrix::Row::sum() const {
-    size_t sum = 0;
-    for (auto& i : _row) {
-        if (i == 1) {
-            ++sum;
-        }
-    }
-    return sum;
+    return std::accumulate(_words.begin(), _words.end(), size_t{0}, [](size_t acc, Word word) {
+        return acc + static_cast<size_t>(std::popcount(word));
+    });
 }
 
 /**
@@ -165,6 +267,10 @@ bool BooleanMatrix::row_operation(size_t ctrl, size_t targ, bool track) {
 
 /**
  * @brief Perform Gaussian Elimination with `block size`. Skip the column if it is duplicated.
+ *        The rows are grouped by their entries in a section through a table of the patterns if the
+ *        blocks are at most 16 columns wide, and through a hash map otherwise. Afterwards, only the
+ *        rows with a non-zero section can have a 1 in its columns, so the pivots are searched for
+ *        and cleared among those rows only.
  *
  * @param blockSize
  * @param fullReduced if true, performing back-substitution from the echelon form
@@ -172,39 +278,68 @@ bool BooleanMatrix::row_operation(size_t ctrl, size_t targ, bool track) {
  * @return size_t (rank)
  */
 size_t BooleanMatrix::gaussian_elimination_skip(size_t block_size, bool do_fully_reduced, bool track) {
+    constexpr size_t max_table_width = 16;
+
     auto get_section_range = [block_size, this](size_t section_idx) {
         auto section_begin = section_idx * block_size;
         auto section_end   = std::min(num_cols(), (section_idx + 1) * block_size);
         return std::make_pair(section_begin, section_end);
     };
 
-    auto get_sub_vec = [this](size_t row_idx, size_t section_begin, size_t section_end) {
-        auto row_begin = dvlab::iterator::next(_matrix[row_idx].get_row().begin(), section_begin);
-        auto row_end   = dvlab::iterator::next(_matrix[row_idx].get_row().begin(), section_end);
-        // NOTE - not all vector, only consider [row_begin, row_end)
-        return std::vector<unsigned char>(row_begin, row_end);
-    };
-
-    auto clear_section_duplicates = [this, get_sub_vec, track](size_t section_begin, size_t section_end, auto row_range) {
-        std::unordered_map<std::vector<unsigned char>, size_t, UCharVectorHash> duplicated;
-        for (auto row_idx : row_range) {
-            auto sub_vec = get_sub_vec(row_idx, section_begin, section_end);
-
-            if (std::ranges::all_of(sub_vec, [](unsigned char const& e) { return e == 0; })) continue;
-
-            if (duplicated.contains(sub_vec)) {
-                row_operation(duplicated[sub_vec], row_idx, track);
-            } else {
-                duplicated[sub_vec] = row_idx;
+    std::vector<size_t> first_row_with_pattern(block_size <= max_table_width ? size_t{1} << block_size : 0, num_rows());
+    std::vector<size_t> nonzero_rows;  // the rows in the range whose section is not all zeros, in the order of the range
+
+    auto clear_section_duplicates = [this, block_size, track, &first_row_with_pattern, &nonzero_rows](size_t section_begin, size_t section_end, auto row_range) {
+        nonzero_rows.clear();
+
+        // `first_row_with` returns the entry of the first row with the section, which is num_rows() if none yet
+        auto const clear_duplicates = [&](auto get_section, auto is_zeros, auto first_row_with) {
+            for (auto row_idx : row_range) {
+                auto const section = get_section(row_idx);
+                if (is_zeros(section)) continue;
+                if (auto& first_row_idx = first_row_with(section); first_row_idx == num_rows()) {
+                    first_row_idx = row_idx;
+                    nonzero_rows.emplace_back(row_idx);
+                } else {
+                    row_operation(first_row_idx, row_idx, track);
+                }
             }
+        };
+        auto const get_bits = [this, section_begin, section_end](size_t row_idx) {
+            return _matrix[row_idx].get_bits(section_begin, section_end);
+        };
+        auto const is_zero_word = [](Row::Word section) { return section == 0; };
+
+        if (block_size <= max_table_width) {
+            clear_duplicates(get_bits, is_zero_word, [&first_row_with_pattern](Row::Word section) -> size_t& {
+                return first_row_with_pattern[section];
+            });
+            // the first rows of the patterns are never changed above, so they still index the table
+            for (auto row_idx : nonzero_rows) {
+                first_row_with_pattern[get_bits(row_idx)] = num_rows();
+            }
+        } else if (section_end - section_begin <= Row::word_size) {
+            // a section fitting in a word is looked up by the word, which saves copying it out as a row
+            std::unordered_map<Row::Word, size_t> duplicated;
+            clear_duplicates(get_bits, is_zero_word, [this, &duplicated](Row::Word section) -> size_t& {
+                return duplicated.try_emplace(section, num_rows()).first->second;
+            });
+        } else {
+            // NOTE - not all row, only consider [section_begin, section_end)
+            std::unordered_map<Row, size_t, RowHash> duplicated;
+            clear_duplicates(
+                [this, section_begin, section_end](size_t row_idx) { return _matrix[row_idx].slice(section_begin, section_end); },
+                [](Row const& section) { return section.is_zeros(); },
+                [this, &duplicated](Row const& section) -> size_t& {
+                    return duplicated.try_emplace(section, num_rows()).first->second;
+                });
         }
     };
 
-    auto clear_all_1s_in_column = [this, track](size_t pivot_row_idx, size_t col_idx, auto row_range) {
-        auto rows_to_clear = row_range | std::views::filter([this, col_idx](size_t row_idx) -> bool {
-                                 return _matrix[row_idx][col_idx] == 1;
-                             });
-        std::ranges::for_each(rows_to_clear, [this, pivot_row_idx, track](size_t row_idx) { row_operation(pivot_row_idx, row_idx, track); });
+    auto clear_all_1s_in_column = [this, track, &nonzero_rows](size_t pivot_row_idx, size_t col_idx, auto is_in_range) {
+        for (auto row_idx : nonzero_rows) {
+            if (is_in_range(row_idx) && _matrix[row_idx][col_idx] == 1) row_operation(pivot_row_idx, row_idx, track);
+        }
     };
 
     auto n_sections = gsl::narrow_cast<size_t>(ceil(static_cast<double>(num_cols()) / static_cast<double>(block_size)));
@@ -216,22 +351,21 @@ size_t BooleanMatrix::gaussian_elimination_skip(size_t block_size, bool do_fully
         clear_section_duplicates(section_begin, section_end, std::views::iota(pivots.size(), num_rows()));
 
         for (auto col_idx : std::views::iota(section_begin, section_end)) {
-            auto const row_idx =
-                std::ranges::find_if(
-                    dvlab::iterator::next(_matrix.begin(), pivots.size()), _matrix.end(),
-                    [col_idx](Row const& row) -> bool {
-                        return row[col_idx] == 1;
-                    }) -
-                _matrix.begin();
-
-            if (std::cmp_greater_equal(row_idx, num_rows())) continue;
-
-            // ensures that the pivot row has a 1 in the current column
-            if (std::cmp_not_equal(row_idx, pivots.size())) {
-                row_operation(row_idx, pivots.size(), track);
+            auto const pivot_row_idx = pivots.size();
+            auto const row_it        = std::ranges::find_if(nonzero_rows, [this, pivot_row_idx, col_idx](size_t row_idx) {
+                return row_idx >= pivot_row_idx && _matrix[row_idx][col_idx] == 1;
+            });
+            if (row_it == nonzero_rows.end()) continue;
+
+            // ensures that the pivot row has a 1 in the current column. Its section may have been all zeros
+            if (*row_it != pivot_row_idx) {
+                row_operation(*row_it, pivot_row_idx, track);
+                if (auto const it = std::ranges::lower_bound(nonzero_rows, pivot_row_idx); it == nonzero_rows.end() || *it != pivot_row_idx) {
+                    nonzero_rows.insert(it, pivot_row_idx);
+                }
             }
 
-            clear_all_1s_in_column(pivots.size(), col_idx, std::views::iota(pivots.size() + 1, num_rows()));
+            clear_all_1s_in_column(pivot_row_idx, col_idx, [pivot_row_idx](size_t row_idx) { return row_idx > pivot_row_idx; });
 
             // records the current columns for fully-reduced
             if (do_fully_reduced) pivots.emplace_back(col_idx);
@@ -248,13 +382,14 @@ size_t BooleanMatrix::gaussian_elimination_skip(size_t block_size, bool do_fully
         auto [section_begin, section_end] = get_section_range(section_idx);
 
         clear_section_duplicates(section_begin, section_end, std::views::iota(0u, pivots.size()) | std::views::reverse);
+        std::ranges::reverse(nonzero_rows);
 
         while (pivots.size() > 0 && section_begin <= pivots.back() && pivots.back() < section_end) {
             // retrieves the last pivot column. This column is guaranteed to have a 1 in the pivot row
             auto last = pivots.back();
             pivots.pop_back();
 
-            clear_all_1s_in_column(pivots.size(), last, std::views::iota(0u, pivots.size()));
+            clear_all_1s_in_column(pivots.size(), last, [n_rows = pivots.size()](size_t row_idx) { return row_idx < n_rows; });
 
             if (pivots.empty()) return rank;
         }
@@ -10,6 +10,7 @@
 #include <spdlog/spdlog.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <vector>
 
@@ -23,37 +24,74 @@ namespace dvlab {
 
 class BooleanMatrix {
 public:
+    // The entries are packed 64 to a word, so that adding rows takes one XOR per word
     class Row {
     public:
-        Row(std::vector<unsigned char> const& r) : _row(r) {}
-        Row(size_t size, unsigned char val) : _row(size, val) {}
-        Row(size_t size) : _row(size, 0) {}
-
-        std::vector<unsigned char> const& get_row() const { return _row; }
-        void set_row(std::vector<unsigned char> row) { _row = std::move(row); }
-        size_t size() const { return _row.size(); }
-        unsigned char& back() { return _row.back(); }
-        unsigned char const& back() const { return _row.back(); }
+        using Word                        = std::uint64_t;
+        static constexpr size_t word_size = 64;
+
+        // A reference to an entry, which is a bit in a word
+        class Reference {
+        public:
+            Reference(Word& word, Word mask) : _word{word}, _mask{mask} {}
+            Reference(Reference const&) = default;
+            ~Reference()                = default;
+
+            operator unsigned char() const { return (_word & _mask) != 0; }  // NOLINT(hicpp-explicit-conversions) : behaves as the entry
+            Reference& operator=(unsigned char val) {
+                _word = (val & 1) ? (_word | _mask) : (_word & ~_mask);
+                return *this;
+            }
+            Reference& operator=(Reference const& other) { return *this = static_cast<unsigned char>(other); }
+            // addition over GF(2)
+            Reference& operator+=(unsigned char val) {
+                if (val & 1) _word ^= _mask;
+                return *this;
+            }
+
+        private:
+            Word& _word;
+            Word _mask;
+        };
+
+        Row(std::vector<unsigned char> const& r);
+        Row(size_t size, unsigned char val);
+        Row(size_t size) : _words(_num_words(size), 0), _size(size) {}
+
+        size_t size() const { return _size; }
+        Reference back() { return (*this)[_size - 1]; }
+        unsigned char back() const { return (*this)[_size - 1]; }
         size_t sum() const;
 
         bool is_one_hot() const;
         bool is_zeros() const;
+        size_t find_first_one(size_t pos = 0) const;
+        Row slice(size_t begin, size_t end) const;
+        Word get_bits(size_t begin, size_t end) const;
         void print_row(spdlog::level::level_enum lvl = spdlog::level::level_enum::off) const;
 
-        void emplace_back(unsigned char i) { _row.emplace_back(i); }
+        // the words holding the entries, from the least significant bit on. The bits past the last entry are 0
+        std::vector<Word> const& get_words() const { return _words; }
+
+        void emplace_back(unsigned char i);
 
         Row& operator+=(Row const& rhs);
         friend Row operator+(Row lhs, Row const& rhs);
+        bool operator==(Row const& rhs) const = default;
 
-        unsigned char& operator[](size_t const& i) {
-            return _row[i];
+        Reference operator[](size_t const& i) {
+            return {_words[i / word_size], Word{1} << (i % word_size)};
         }
-        unsigned char const& operator[](size_t const& i) const {
-            return _row[i];
+        unsigned char operator[](size_t const& i) const {
+            return (_words[i / word_size] >> (i % word_size)) & 1;
         }
 
     private:
-        std::vector<unsigned char> _row;
+        std::vector<Word> _words;
+        size_t _size;
+
+        static size_t _num_words(size_t size) { return (size + word_size - 1) / word_size; }
+        void _clear_padding();
     };
     using RowOperation = std::pair<size_t, size_t>;
 
@@ -90,7 +128,7 @@ public:
     double dense_ratio();
     void append_one_hot_column(size_t idx);
     void push_zeros_column();
-    void push_zeros_row() { _matrix.emplace_back(std::vector<unsigned char>(_matrix[0].size(), 0)); }
+    void push_zeros_row() { _matrix.emplace_back(_matrix[0].size()); }
     void push_row(Row const& row) { _matrix.emplace_back(row); }
     void push_wor(Row&& row) { _matrix.emplace_back(std::move(row)); }
 
@@ -0,0 +1,213 @@
+/****************************************************************************
+  PackageName  [ util ]
+  Synopsis     [ Define ObjectPool ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+/********************** Summary of this data structure **********************
+ *
+ *     ObjectPool is a chunked arena for objects of a single type. Objects are
+ * constructed in place inside large, contiguous chunks instead of being
+ * individually allocated with `new`, so that objects created together also
+ * live together in memory.
+ *
+ * Important features:
+ * - O(1) creation (amortized), without calling the global allocator
+ * - O(1) destruction; the slot is recycled through an intrusive free list
+ * - pointers to objects are stable for the lifetime of the pool
+ * - all memory is returned at once when the pool is destroyed
+ * - the chunks of another pool can be adopted without moving any object
+ *
+ * Caveats:
+ * 1.  The pool does not keep track of which slots are alive. The owner must
+ *     destroy every live object (with `destroy` or `destroy_unrecycled`)
+ *     before the pool itself is destroyed or cleared.
+ *
+ * 2.  The pool is not thread-safe.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace dvlab {
+
+namespace utils {
+
+template <typename T>
+class ObjectPool {
+public:
+    ObjectPool() = default;
+    ~ObjectPool() = default;
+
+    ObjectPool(ObjectPool const&)            = delete;
+    ObjectPool& operator=(ObjectPool const&) = delete;
+
+    ObjectPool(ObjectPool&& other) noexcept
+        : _chunks{std::move(other._chunks)},
+          _free_list{std::exchange(other._free_list, nullptr)},
+          _bump_ptr{std::exchange(other._bump_ptr, nullptr)},
+          _bump_end{std::exchange(other._bump_end, nullptr)},
+          _capacity{std::exchange(other._capacity, 0)} {
+        other._chunks.clear();
+    }
+
+    ObjectPool& operator=(ObjectPool&& other) noexcept {
+        ObjectPool tmp{std::move(other)};
+        swap(tmp);
+        return *this;
+    }
+
+    void swap(ObjectPool& other) noexcept {
+        std::swap(_chunks, other._chunks);
+        std::swap(_free_list, other._free_list);
+        std::swap(_bump_ptr, other._bump_ptr);
+        std::swap(_bump_end, other._bump_end);
+        std::swap(_capacity, other._capacity);
+    }
+
+    friend void swap(ObjectPool& a, ObjectPool& b) noexcept { a.swap(b); }
+
+    /**
+     * @brief Construct an object in the pool.
+     *
+     * @return T* a pointer to the object, which stays valid until the object is destroyed.
+     */
+    template <typename... Args>
+    T* create(Args&&... args) {
+        Slot* slot = _acquire_slot();
+        try {
+            return std::construct_at(reinterpret_cast<T*>(slot->storage), std::forward<Args>(args)...);
+        } catch (...) {
+            _recycle_slot(slot);
+            throw;
+        }
+    }
+
+    /**
+     * @brief Destroy an object created by this pool and recycle its slot.
+     *
+     * @param obj
+     */
+    void destroy(T* obj) noexcept {
+        std::destroy_at(obj);
+        _recycle_slot(reinterpret_cast<Slot*>(obj));
+    }
+
+    /**
+     * @brief Destroy an object without recycling its slot. This is useful when
+     *        the whole pool is about to be cleared.
+     *
+     * @param obj
+     */
+    static void destroy_unrecycled(T* obj) noexcept { std::destroy_at(obj); }
+
+    /**
+     * @brief Make sure that the next `n` creations do not allocate more than one chunk.
+     *
+     * @param n
+     */
+    void reserve(size_t n) {
+        auto const bump_slots = static_cast<size_t>(_bump_end - _bump_ptr);
+        if (bump_slots >= n) return;
+        _allocate_chunk(std::max(n, _next_chunk_size()));
+    }
+
+    /**
+     * @brief Take over all the storage of `other`. Objects in `other` are not moved,
+     *        so pointers to them stay valid and they now belong to this pool.
+     *
+     * @param other
+     */
+    void adopt(ObjectPool&& other) {
+        // the unused tail of other's current chunk becomes free slots
+        for (Slot* slot = other._bump_ptr; slot != other._bump_end; ++slot) {
+            other._recycle_slot(slot);
+        }
+        if (other._free_list != nullptr) {
+            Slot* tail = other._free_list;
+            while (tail->next != nullptr) tail = tail->next;
+            tail->next = _free_list;
+            _free_list = other._free_list;
+        }
+        // keep our current chunk at the back, since it is the one we bump-allocate from
+        _chunks.insert(_chunks.begin(),
+                       std::make_move_iterator(other._chunks.begin()),
+                       std::make_move_iterator(other._chunks.end()));
+        _capacity += other._capacity;
+
+        other._chunks.clear();
+        other._free_list = nullptr;
+        other._bump_ptr  = nullptr;
+        other._bump_end  = nullptr;
+        other._capacity  = 0;
+    }
+
+    /**
+     * @brief Release all the storage at once. All objects must have been destroyed.
+     *
+     */
+    void clear() noexcept {
+        _chunks.clear();
+        _free_list = nullptr;
+        _bump_ptr  = nullptr;
+        _bump_end  = nullptr;
+        _capacity  = 0;
+    }
+
+    size_t capacity() const { return _capacity; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    static constexpr size_t min_chunk_size = 64;
+    static constexpr size_t max_chunk_size = 4096;
+
+    std::vector<std::unique_ptr<Slot[]>> _chunks;
+    Slot* _free_list = nullptr;
+    Slot* _bump_ptr  = nullptr;
+    Slot* _bump_end  = nullptr;
+    size_t _capacity = 0;
+
+    size_t _next_chunk_size() const { return std::clamp(_capacity, min_chunk_size, max_chunk_size); }
+
+    void _allocate_chunk(size_t n) {
+        // the leftover of the current chunk is not wasted
+        for (Slot* slot = _bump_ptr; slot != _bump_end; ++slot) {
+            _recycle_slot(slot);
+        }
+        _chunks.emplace_back(std::make_unique_for_overwrite<Slot[]>(n));
+        _bump_ptr = _chunks.back().get();
+        _bump_end = _bump_ptr + n;
+        _capacity += n;
+    }
+
+    Slot* _acquire_slot() {
+        if (_free_list != nullptr) {
+            return std::exchange(_free_list, _free_list->next);
+        }
+        if (_bump_ptr == _bump_end) {
+            _allocate_chunk(_next_chunk_size());
+        }
+        return _bump_ptr++;
+    }
+
+    void _recycle_slot(Slot* slot) noexcept {
+        slot->next = _free_list;
+        _free_list = slot;
+    }
+};
+
+}  // namespace utils
+
+}  // namespace dvlab
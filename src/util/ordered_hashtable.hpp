@@ -20,6 +20,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <iterator>
 #include <optional>
 #include <ranges>
@@ -197,6 +198,20 @@ public:
     size_t erase(Key const& key);
     size_t erase(iterator const& itr);
 
+    /**
+     * @brief Postpone the sweeps triggered by erasure until `resume_sweep` is
+     *        called, so that the ids of the elements stay stable. Calls can be
+     *        nested.
+     *
+     */
+    void suspend_sweep() { _sweep_suspension++; }
+    void resume_sweep() {
+        if (--_sweep_suspension == 0 && this->_data.size() >= (this->_size * 4)) {
+            this->sweep();
+        }
+    }
+    void restore(size_type id, value_type const& value);
+
     template <typename F>
     void sort(F lambda);
 
@@ -204,6 +219,7 @@ protected:
     std::unordered_map<Key, size_t, Hash, KeyEqual> _key2id = {};
     container _data                                         = {};
     size_t _size                                            = 0;
+    size_t _sweep_suspension                                = 0;
 };
 
 //------------------------------------------------------
@@ -325,12 +341,28 @@ size_t ordered_hashtable<Key, Value, StoredType, Hash, KeyEqual>::erase(Key cons
     this->_key2id.erase(key);
     this->_size--;
 
-    if (this->_data.size() >= (this->_size * 4)) {
+    if (_sweep_suspension == 0 && this->_data.size() >= (this->_size * 4)) {
         this->sweep();
     }
     return 1;
 }
 
+/**
+ * @brief Put an erased element back to where it was, i.e., undo the erasure.
+ *        `id` must be the id of the element before it was erased, and the
+ *        sweeps must have been suspended since then.
+ *
+ * @param id
+ * @param value
+ */
+template <typename Key, typename Value, typename StoredType, typename Hash, typename KeyEqual>
+void ordered_hashtable<Key, Value, StoredType, Hash, KeyEqual>::restore(size_type id, value_type const& value) {
+    assert(_sweep_suspension > 0 && id < this->_data.size() && !this->_data[id].has_value());
+    this->_data[id].emplace(value);
+    this->_key2id.emplace(this->key(this->_data[id].value()), id);
+    this->_size++;
+}
+
 /**
  * @brief Erase the key-value pair with the given iterator. To achieve a-
  *        mortized O(1) deletion, this function only mark the key-value pair
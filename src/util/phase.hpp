@@ -9,7 +9,10 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
+#include <cstdint>
 #include <iosfwd>
 #include <numbers>
 #include <optional>
@@ -103,6 +106,12 @@ public:
 
 private:
     dvlab::Rational _rational;
+
+    // Phases of the form k*pi/2^n are dyadic. Since the phase is kept reduced, the
+    // denominator of a dyadic phase is exactly 2^n, so no separate representation is
+    // needed to add them without computing gcds.
+    constexpr bool _is_dyadic() const { return std::has_single_bit(static_cast<unsigned>(denominator())); }
+    constexpr void _add_dyadic(IntegralType rhs_numerator, IntegralType rhs_denominator);
 };
 
 constexpr Phase& Phase::operator*=(unitless auto const& rhs) {
@@ -132,19 +141,54 @@ constexpr Phase Phase::operator+() const {
 }
 
 constexpr Phase Phase::operator-() const {
-    return Phase(-_rational.numerator(), _rational.denominator());
+    // negating a phase in (-pi, pi) keeps it in range and reduced; pi is its own negation
+    if (numerator() == denominator()) return *this;
+    Phase ret;
+    ret._rational = Rational::from_reduced(-numerator(), denominator());
+    return ret;
 }
 
 constexpr Phase& Phase::operator+=(Phase const& rhs) {
+    if (_is_dyadic() && rhs._is_dyadic()) {
+        _add_dyadic(rhs.numerator(), rhs.denominator());
+        return *this;
+    }
     this->_rational += rhs._rational;
     normalize();
     return *this;
 }
 constexpr Phase& Phase::operator-=(Phase const& rhs) {
+    if (_is_dyadic() && rhs._is_dyadic()) {
+        _add_dyadic(-rhs.numerator(), rhs.denominator());
+        return *this;
+    }
     this->_rational -= rhs._rational;
     normalize();
     return *this;
 }
+
+/**
+ * @brief Add a dyadic rational (in units of pi) to a dyadic phase. Both operands lie in [-pi, pi],
+ *        so the sum only needs to be wrapped once, and reducing the result amounts to
+ *        cancelling the common powers of two.
+ *
+ */
+constexpr void Phase::_add_dyadic(IntegralType rhs_numerator, IntegralType rhs_denominator) {
+    auto const lhs_exponent  = std::countr_zero(static_cast<unsigned>(denominator()));
+    auto const rhs_exponent  = std::countr_zero(static_cast<unsigned>(rhs_denominator));
+    auto const exponent      = std::max(lhs_exponent, rhs_exponent);
+    std::int64_t const denom = std::int64_t{1} << exponent;
+    std::int64_t numer       = (std::int64_t{numerator()} << (exponent - lhs_exponent)) + (std::int64_t{rhs_numerator} << (exponent - rhs_exponent));
+    if (numer > denom) numer -= 2 * denom;
+    if (numer <= -denom) numer += 2 * denom;
+    if (numer == 0) {
+        _rational = Rational::from_reduced(0, 1);
+        return;
+    }
+    auto const shift = std::min(std::countr_zero(static_cast<std::uint64_t>(numer)), exponent);
+    _rational        = Rational::from_reduced(static_cast<IntegralType>(numer >> shift), static_cast<IntegralType>(denom >> shift));
+}
+
 constexpr Phase operator+(Phase lhs, Phase const& rhs) {
     lhs += rhs;
     return lhs;
@@ -237,9 +281,12 @@ bool Phase::str_to_phase(std::string_view str, Phase& p) {
  *
  */
 constexpr void Phase::normalize() {
-    constexpr auto floor = [](Rational const& q) -> IntegralType { return (q.numerator() - (q.numerator() >= 0 ? 0 : q.denominator())) / q.denominator(); };
-    _rational -= (floor(_rational / 2) * 2);
-    if (_rational > 1) _rational -= 2;
+    // the rational is kept reduced, and shifting the numerator by multiples of the denominator keeps it so
+    std::int64_t const denom = denominator();
+    std::int64_t numer       = numerator() % (2 * denom);
+    if (numer > denom) numer -= 2 * denom;
+    if (numer <= -denom) numer += 2 * denom;
+    _rational = Rational::from_reduced(static_cast<IntegralType>(numer), static_cast<IntegralType>(denom));
 }
 
 }  // namespace dvlab
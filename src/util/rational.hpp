@@ -36,6 +36,14 @@ public:
         assert(d != 0);
         reduce();
     }
+    // Skip the reduction when the numerator and the (positive) denominator are known to be coprime
+    constexpr static Rational from_reduced(IntegralType n, IntegralType d) {
+        assert(d > 0);
+        Rational q;
+        q._numer = n;
+        q._denom = d;
+        return q;
+    }
     // Implicitly use 1 as denominator
     template <class T>
     requires std::floating_point<T>
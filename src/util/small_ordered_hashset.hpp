@@ -0,0 +1,482 @@
+/****************************************************************************
+  PackageName  [ util ]
+  Synopsis     [ Define small_ordered_hashset ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+/********************** Summary of this data structure **********************
+ *
+ *     small_ordered_hashset is an insertion-ordered hash set optimized for
+ * sets that are usually small. It offers the same ordering guarantees as
+ * ordered_hashset, but avoids per-set heap allocations for small sizes.
+ *
+ * Important features:
+ * - No heap allocation as long as the set holds at most InlineCapacity items
+ * - O(1) insertion (amortized)
+ * - O(1) deletion  (amortized)
+ * - O(1) lookup
+ * - Elements are stored in the order of insertion.
+ * - bidirectional iterator
+ *
+ * How does small_ordered_hashset work?
+ *     While the set is small, items are stored contiguously in an inline
+ * buffer inside the object itself. Lookups are linear scans over this buffer,
+ * which is faster than hashing for a handful of items, and deletion shifts
+ * the succeeding items forward to keep the insertion order.
+ *
+ *     Once the inline buffer overflows, the items spill to a heap-allocated
+ * linear storage, accompanied with a flat open-addressing (linear probing)
+ * index that maps hashes to positions in the linear storage. Deletion then
+ * marks the item as erased, like ordered_hashset does, and the linear stor-
+ * age is swept when more than half of it is erased. If the set becomes small
+ * enough after a sweep, the items move back to the inline buffer.
+ *
+ * Caveats:
+ * 1.  The value-initialized key `Key{}` marks erased slots, so it must never
+ *     be inserted into the set.
+ *
+ * 2.  Iterators are invalidated upon insertion/deletion. Moreover, as the
+ *     inline buffer lives in the object, iterators are also invalidated when
+ *     the set is moved or swapped.
+ *
+ * 3.  Keys should be trivially copyable. This is asserted at compile time.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace dvlab {
+
+namespace utils {
+
+template <typename Key, size_t InlineCapacity, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class small_ordered_hashset {  // NOLINT(readability-identifier-naming) : small_ordered_hashset intentionally mimics std::unordered_set
+    static_assert(std::is_trivially_copy_constructible_v<Key> && std::is_trivially_destructible_v<Key>,
+                  "small_ordered_hashset only supports trivially copyable keys");
+    static_assert(InlineCapacity > 0, "the inline capacity must be positive");
+
+public:
+    using key_type        = Key;
+    using value_type      = Key;
+    using size_type       = size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = KeyEqual;
+    using reference       = Key const&;
+    using const_reference = Key const&;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type        = Key;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = Key const*;
+        using reference         = Key const&;
+
+        const_iterator() = default;
+        const_iterator(Key const* ptr, Key const* last) : _ptr{ptr}, _last{last} { _skip_forward(); }
+
+        reference operator*() const noexcept { return *_ptr; }
+        pointer operator->() const noexcept { return _ptr; }
+
+        const_iterator& operator++() noexcept {
+            ++_ptr;
+            _skip_forward();
+            return *this;
+        }
+        const_iterator operator++(int) noexcept {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        const_iterator& operator--() noexcept {
+            do {
+                --_ptr;
+            } while (_is_erased(*_ptr));
+            return *this;
+        }
+        const_iterator operator--(int) noexcept {
+            auto tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        bool operator==(const_iterator const& rhs) const noexcept { return _ptr == rhs._ptr; }
+
+    private:
+        Key const* _ptr  = nullptr;
+        Key const* _last = nullptr;
+
+        void _skip_forward() noexcept {
+            while (_ptr != _last && _is_erased(*_ptr)) ++_ptr;
+        }
+    };
+
+    using iterator = const_iterator;
+
+    small_ordered_hashset() = default;
+    ~small_ordered_hashset() = default;
+
+    small_ordered_hashset(small_ordered_hashset const& other) { _copy_from(other); }
+    small_ordered_hashset(small_ordered_hashset&& other) noexcept
+        : _inline{other._inline},
+          _heap{std::move(other._heap)},
+          _index{std::move(other._index)},
+          _size{std::exchange(other._size, 0)},
+          _end{std::exchange(other._end, 0)},
+          _heap_capacity{std::exchange(other._heap_capacity, 0)},
+          _index_bits{std::exchange(other._index_bits, 0)} {}
+
+    small_ordered_hashset& operator=(small_ordered_hashset const& other) {
+        if (this != &other) _copy_from(other);
+        return *this;
+    }
+    small_ordered_hashset& operator=(small_ordered_hashset&& other) noexcept {
+        if (this != &other) {
+            _inline        = other._inline;
+            _heap          = std::move(other._heap);
+            _index         = std::move(other._index);
+            _size          = std::exchange(other._size, 0);
+            _end           = std::exchange(other._end, 0);
+            _heap_capacity = std::exchange(other._heap_capacity, 0);
+            _index_bits    = std::exchange(other._index_bits, 0);
+        }
+        return *this;
+    }
+
+    // iterators
+    const_iterator begin() const noexcept { return const_iterator(_storage(), _storage() + _end); }
+    const_iterator end() const noexcept { return const_iterator(_storage() + _end, _storage() + _end); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    // lookup
+    bool contains(Key const& key) const { return _find_position(key) != npos; }
+    size_t count(Key const& key) const { return contains(key) ? 1 : 0; }
+    const_iterator find(Key const& key) const {
+        auto const pos = _find_position(key);
+        return pos == npos ? end() : const_iterator(_storage() + pos, _storage() + _end);
+    }
+    size_t index_of(Key const& key) const;
+
+    // properties
+    size_t size() const noexcept { return _size; }
+    bool empty() const noexcept { return _size == 0; }
+    bool is_inline() const noexcept { return _heap == nullptr; }
+
+    bool operator==(small_ordered_hashset const& rhs) const {
+        if (_size != rhs._size) return false;
+        return std::all_of(begin(), end(), [&rhs](Key const& key) { return rhs.contains(key); });
+    }
+
+    // container manipulation
+    template <typename... Args>
+    std::pair<const_iterator, bool> emplace(Args&&... args) { return insert(Key(std::forward<Args>(args)...)); }
+
+    std::pair<const_iterator, bool> insert(Key const& key);
+    void insert_at(size_t index, Key const& key);
+
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) insert(*first);
+    }
+
+    size_t erase(Key const& key);
+    size_t erase(const_iterator const& itr) { return erase(*itr); }
+
+    template <std::forward_iterator ForwardIt>
+    void assign_unique(ForwardIt first, ForwardIt last);
+
+    void clear() noexcept {
+        _heap.reset();
+        _index.reset();
+        _size          = 0;
+        _end           = 0;
+        _heap_capacity = 0;
+        _index_bits    = 0;
+    }
+
+private:
+    static constexpr size_t npos             = static_cast<size_t>(-1);
+    static constexpr uint32_t empty_entry    = 0;
+    static constexpr uint32_t erased_entry   = static_cast<uint32_t>(-1);
+    static constexpr uint64_t fibonacci_hash = 0x9E3779B97F4A7C15ull;
+
+    std::array<Key, InlineCapacity> _inline{};
+    std::unique_ptr<Key[]> _heap;
+    // open-addressing index; each entry is either empty, erased, or (position + 1)
+    std::unique_ptr<uint32_t[]> _index;
+    uint32_t _size          = 0;  // number of live items
+    uint32_t _end           = 0;  // number of used slots in the linear storage, including the erased ones
+    uint32_t _heap_capacity = 0;
+    uint32_t _index_bits    = 0;
+
+    static bool _is_erased(Key const& key) noexcept { return KeyEqual{}(key, Key{}); }
+
+    Key* _storage() noexcept { return is_inline() ? _inline.data() : _heap.get(); }
+    Key const* _storage() const noexcept { return is_inline() ? _inline.data() : _heap.get(); }
+
+    size_t _index_size() const noexcept { return size_t{1} << _index_bits; }
+
+    // the hash is scrambled so that hashes with poor low bits, such as pointers, spread evenly
+    size_t _home_bucket(Key const& key) const noexcept {
+        return static_cast<size_t>((static_cast<uint64_t>(Hash{}(key)) * fibonacci_hash) >> (64 - _index_bits));
+    }
+
+    size_t _find_position(Key const& key) const;
+    size_t _find_bucket(Key const& key) const;
+    void _spill(uint32_t capacity);
+    void _rebuild_index();
+    void _sweep();
+    void _copy_from(small_ordered_hashset const& other);
+};
+
+//------------------------------------------------------------------------
+//  Member function definitions
+//------------------------------------------------------------------------
+
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+size_t small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::_find_position(Key const& key) const {
+    if (is_inline()) {
+        for (size_t i = 0; i < _size; ++i) {
+            if (KeyEqual{}(_inline[i], key)) return i;
+        }
+        return npos;
+    }
+    auto const bucket = _find_bucket(key);
+    return bucket == npos ? npos : _index[bucket] - 1;
+}
+
+/**
+ * @brief Return the bucket of the index that refers to the key, or npos if the key is not in the set.
+ *        Only valid when the set has spilled to the heap.
+ *
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+size_t small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::_find_bucket(Key const& key) const {
+    auto const mask = _index_size() - 1;
+    for (auto bucket = _home_bucket(key);; bucket = (bucket + 1) & mask) {
+        auto const entry = _index[bucket];
+        if (entry == empty_entry) return npos;
+        if (entry != erased_entry && KeyEqual{}(_heap[entry - 1], key)) return bucket;
+    }
+}
+
+/**
+ * @brief Insert the key at the end of the set if it is not already in the set.
+ *
+ * @return std::pair<const_iterator, bool> the iterator to the key, and whether the insertion took place
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+std::pair<typename small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::const_iterator, bool>
+small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::insert(Key const& key) {
+    assert(!_is_erased(key));
+    if (auto const pos = _find_position(key); pos != npos) {
+        return {const_iterator(_storage() + pos, _storage() + _end), false};
+    }
+
+    if (is_inline()) {
+        if (_size < InlineCapacity) {
+            _inline[_size] = key;
+            ++_size;
+            ++_end;
+            return {const_iterator(_inline.data() + _size - 1, _inline.data() + _end), true};
+        }
+        _spill(2 * InlineCapacity);
+    } else if (_end == _heap_capacity) {
+        // reclaim the erased slots if there are enough of them; grow otherwise
+        if (4 * _size <= 3 * _heap_capacity) {
+            _sweep();
+        } else {
+            _spill(2 * _heap_capacity);
+        }
+        if (is_inline()) return insert(key);
+    }
+
+    _heap[_end] = key;
+    auto const mask = _index_size() - 1;
+    auto bucket     = _home_bucket(key);
+    while (_index[bucket] != empty_entry && _index[bucket] != erased_entry) bucket = (bucket + 1) & mask;
+    _index[bucket] = _end + 1;
+    ++_size;
+    ++_end;
+    return {const_iterator(_heap.get() + _end - 1, _heap.get() + _end), true};
+}
+
+/**
+ * @brief Replace the content with the keys in [first, last), which must be
+ *        distinct. This skips the duplicate checks of `insert` and sizes the
+ *        storage only once, which is useful for bulk copies.
+ *
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+template <std::forward_iterator ForwardIt>
+void small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::assign_unique(ForwardIt first, ForwardIt last) {
+    clear();
+    auto const n = static_cast<uint32_t>(std::distance(first, last));
+    if (n <= InlineCapacity) {
+        std::copy(first, last, _inline.begin());
+        _size = n;
+        _end  = n;
+        return;
+    }
+    _heap = std::make_unique<Key[]>(n);
+    std::copy(first, last, _heap.get());
+    _size          = n;
+    _end           = n;
+    _heap_capacity = n;
+    _index_bits    = static_cast<uint32_t>(std::bit_width(2 * n - 1));
+    _rebuild_index();
+}
+
+/**
+ * @brief Return the number of keys inserted before `key`, or the size of the set if `key` is not in the set.
+ *
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+size_t small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::index_of(Key const& key) const {
+    auto const pos = _find_position(key);
+    if (pos == npos) return _size;
+    return static_cast<size_t>(std::count_if(_storage(), _storage() + pos, [](Key const& k) { return !_is_erased(k); }));
+}
+
+/**
+ * @brief Insert the key so that exactly `index` keys precede it. The key must
+ *        not be in the set. This undoes an erasure given the `index_of` the
+ *        key before it was erased.
+ *
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+void small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::insert_at(size_t index, Key const& key) {
+    assert(index <= _size && !contains(key));
+    if (index == _size) {
+        insert(key);
+        return;
+    }
+    if (is_inline() && _size < InlineCapacity) {
+        std::copy_backward(_inline.begin() + index, _inline.begin() + _size, _inline.begin() + _size + 1);
+        _inline[index] = key;
+        ++_size;
+        ++_end;
+        return;
+    }
+    auto keys = std::make_unique<Key[]>(_size + 1);
+    auto last = std::copy_if(_storage(), _storage() + _end, keys.get(), [](Key const& k) { return !_is_erased(k); });
+    std::copy_backward(keys.get() + index, last, last + 1);
+    keys[index] = key;
+    assign_unique(keys.get(), last + 1);
+}
+
+/**
+ * @brief Erase the key from the set. The relative order of the remaining keys is unchanged.
+ *
+ * @return size_t the number of erased keys
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+size_t small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::erase(Key const& key) {
+    if (is_inline()) {
+        auto const pos = _find_position(key);
+        if (pos == npos) return 0;
+        std::copy(_inline.begin() + pos + 1, _inline.begin() + _size, _inline.begin() + pos);
+        --_size;
+        --_end;
+        return 1;
+    }
+
+    auto const bucket = _find_bucket(key);
+    if (bucket == npos) return 0;
+    _heap[_index[bucket] - 1] = Key{};
+    _index[bucket]            = erased_entry;
+    --_size;
+    if (2 * _size < _end) _sweep();
+    return 1;
+}
+
+/**
+ * @brief Move the items to a heap storage of the given capacity and rebuild the index.
+ *
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+void small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::_spill(uint32_t capacity) {
+    auto heap = std::make_unique<Key[]>(capacity);
+    std::copy_if(_storage(), _storage() + _end, heap.get(), [](Key const& key) { return !_is_erased(key); });
+    _heap          = std::move(heap);
+    _end           = _size;
+    _heap_capacity = capacity;
+    // keep the load factor of the index at most 1/2
+    _index_bits = static_cast<uint32_t>(std::bit_width(2 * capacity - 1));
+    _rebuild_index();
+}
+
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+void small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::_rebuild_index() {
+    _index          = std::make_unique<uint32_t[]>(_index_size());  // value-initialized to empty_entry
+    auto const mask = _index_size() - 1;
+    for (uint32_t pos = 0; pos < _end; ++pos) {
+        auto bucket = _home_bucket(_heap[pos]);
+        while (_index[bucket] != empty_entry) bucket = (bucket + 1) & mask;
+        _index[bucket] = pos + 1;
+    }
+}
+
+/**
+ * @brief Remove the erased slots from the linear storage. Move back to the
+ *        inline buffer if the items fit in.
+ *
+ */
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+void small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::_sweep() {
+    if (_size <= InlineCapacity) {
+        std::copy_if(_heap.get(), _heap.get() + _end, _inline.begin(), [](Key const& key) { return !_is_erased(key); });
+        _heap.reset();
+        _index.reset();
+        _end           = _size;
+        _heap_capacity = 0;
+        _index_bits    = 0;
+        return;
+    }
+    auto const last = std::remove_if(_heap.get(), _heap.get() + _end, [](Key const& key) { return _is_erased(key); });
+    _end            = static_cast<uint32_t>(last - _heap.get());
+    _rebuild_index();
+}
+
+template <typename Key, size_t InlineCapacity, typename Hash, typename KeyEqual>
+void small_ordered_hashset<Key, InlineCapacity, Hash, KeyEqual>::_copy_from(small_ordered_hashset const& other) {
+    clear();
+    if (other.is_inline()) {
+        _inline = other._inline;
+        _size   = other._size;
+        _end    = other._end;
+        return;
+    }
+    _size = other._size;
+    _end  = other._end;
+    // a copy only needs as much room as the live items
+    if (_size <= InlineCapacity) {
+        std::copy_if(other._heap.get(), other._heap.get() + other._end, _inline.begin(), [](Key const& key) { return !_is_erased(key); });
+        _end = _size;
+        return;
+    }
+    _heap = std::make_unique<Key[]>(other._heap_capacity);
+    std::copy_if(other._heap.get(), other._heap.get() + other._end, _heap.get(), [](Key const& key) { return !_is_erased(key); });
+    _end           = _size;
+    _heap_capacity = other._heap_capacity;
+    _index_bits    = other._index_bits;
+    _rebuild_index();
+}
+
+}  // namespace utils
+
+}  // namespace dvlab
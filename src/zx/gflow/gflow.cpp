@@ -75,15 +75,22 @@ void GFlow::_initialize() {
     }
     // if calculating extended gflow, modify some of the measurment plane
     if (_do_extended) {
-        for (auto const& v : _zxgraph->get_vertices()) {
+        // only the vertices of degree 1 and their neighbors can be gadget leaves and axels
+        _zxgraph->update_gadget_index();
+        auto const leaves = _zxgraph->get_gadget_leaves();
+        for (auto const& v : leaves) {
             if (_zxgraph->is_gadget_leaf(v)) {
                 _measurement_planes[v] = MP::not_a_qubit;
                 _taken.insert(v);
-            } else if (_zxgraph->is_gadget_axel(v))
-                _measurement_planes[v] = v->has_n_pi_phase() ? MP::yz
-                                         : v->get_phase().denominator() == 2
-                                             ? MP::xz
-                                             : MP::error;
+            }
+        }
+        for (auto const& leaf : leaves) {
+            auto const v = _zxgraph->get_first_neighbor(leaf).first;
+            if (_measurement_planes[v] == MP::not_a_qubit || !_zxgraph->is_gadget_axel(v)) continue;
+            _measurement_planes[v] = v->has_n_pi_phase() ? MP::yz
+                                     : v->get_phase().denominator() == 2
+                                         ? MP::xz
+                                         : MP::error;
             assert(_measurement_planes[v] != MP::error);
         }
     }
@@ -243,10 +250,6 @@ dvlab::BooleanMatrix GFlow::_prepare_matrix(ZXVertex* v, size_t i, dvlab::Boolea
         ++itr;
     }
 
-    for (size_t j = 0; j < augmented_matrix.num_rows(); ++j) {
-        augmented_matrix[j][augmented_matrix.num_cols() - 1] %= 2;
-    }
-
     return augmented_matrix;
 }
 
@@ -1,5 +1,9 @@
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <mutex>
+#include <optional>
+#include <vector>
 #include <util/util.hpp>
 
 #include "./rules/zx_rules_template.hpp"
@@ -11,49 +15,90 @@ using namespace qsyn::zx;
 
 void scoped_full_reduce(ZXGraph* graph, ZXVertexList const& scope);
 void scoped_dynamic_reduce(ZXGraph* graph, ZXVertexList const& scope);
-size_t scoped_interior_clifford_simp(ZXGraph* graph, ZXVertexList const& scope);
-size_t scoped_clifford_simp(ZXGraph* graph, ZXVertexList const& scope);
+
+// the simplifier is shared by the steps so that the H-boxes of the graph are converted only once
+void scoped_full_reduce(Simplifier& simplifier, ZXVertexList const& scope);
+size_t scoped_interior_clifford_simp(Simplifier& simplifier, ZXVertexList const& scope);
+size_t scoped_clifford_simp(Simplifier& simplifier, ZXVertexList const& scope);
 
 /**
- * @brief partition the graph into 2^numPartitions partitions and reduce each partition separately
- *        then merge the partitions together for n rounds (experimental)
+ * @brief partition the graph into `n_partitions` partitions and reduce each partition separately,
+ *        then merge the partitions together. The subgraphs of a round are reduced concurrently.
+ *        Each further round partitions the merged graph again with the cuts shifted away from the
+ *        previous ones, so that the vertices next to them can be reduced as well (experimental)
  *
- * @param numPartitions number of partitions to create
- * @param iterations number of iterations
+ * @param n_partitions number of partitions to create
+ * @param n_rounds number of partition and merge rounds
  */
-void Simplifier::partition_reduce(size_t n_partitions) {
-    auto const partitions        = kl_partition(*_simp_graph, n_partitions);
-    auto const [subgraphs, cuts] = _simp_graph->create_subgraphs(partitions);
-
-    for (auto& graph : subgraphs) {
-        auto simplifier = Simplifier(graph);
-        simplifier.dynamic_reduce();
+void Simplifier::partition_reduce(size_t n_partitions, size_t n_rounds) {
+    ZXVertexList cut_vertices;
+    for (size_t round = 0; round < n_rounds && !_should_stop(); ++round) {
+        auto const partitions        = kl_partition(*_simp_graph, n_partitions, cut_vertices);
+        auto const [subgraphs, cuts] = _simp_graph->create_subgraphs(partitions);
+
+        // the subgraphs share the remaining effort: their simplifiers add the iterations they apply to
+        // a common count in their cancellation hooks, which also call the hook of this simplifier
+        auto const remaining_effort = _effort_limit.has_value()
+                                          ? std::optional{*_effort_limit - std::min(*_effort_limit, _num_applied_iterations)}
+                                          : std::nullopt;
+        std::atomic<size_t> num_applied_in_round = 0;
+        std::mutex cancellation_mutex;  // the hook of this simplifier is not called concurrently
+
+        // the rules run single-threaded inside each subgraph, as nested parallelism is off by default
+        std::vector<SimplifierProfile> profiles(subgraphs.size());
+        std::vector<size_t> num_applied_iterations(subgraphs.size());
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < subgraphs.size(); ++i) {
+            auto simplifier = Simplifier(subgraphs[i]);
+            simplifier.set_profile(_profile != nullptr ? &profiles[i] : nullptr);
+            simplifier.set_incremental_matching(_incremental_matching);
+            simplifier.set_deadline(_deadline);
+            simplifier.set_effort_limit(remaining_effort);
+            size_t num_reported = 0;
+            simplifier.set_cancellation([&, this]() {
+                auto const num_applied = simplifier.get_num_applied_iterations();
+                auto const total       = num_applied_in_round.fetch_add(num_applied - num_reported) + (num_applied - num_reported);
+                num_reported           = num_applied;
+                if (remaining_effort.has_value() && total >= *remaining_effort) return true;
+                std::lock_guard const lock{cancellation_mutex};
+                return is_cancelled();
+            });
+            simplifier.dynamic_reduce();
+            num_applied_iterations[i] = simplifier.get_num_applied_iterations();
+        }
+        for (size_t i = 0; i < subgraphs.size(); ++i) {
+            if (_profile != nullptr) _profile->merge(profiles[i]);
+            _num_applied_iterations += num_applied_iterations[i];
+        }
+
+        cut_vertices.clear();
+        ZXGraph* const temp_graph = ZXGraph::from_subgraphs(subgraphs, cuts, &cut_vertices);
+        _simp_graph->swap(*temp_graph);
+        delete temp_graph;
     }
 
-    ZXGraph* const temp_graph = ZXGraph::from_subgraphs(subgraphs, cuts);
-    _simp_graph->swap(*temp_graph);
-    delete temp_graph;
-
     spider_fusion_simp();
 }
 
 void scoped_dynamic_reduce(ZXGraph* graph, ZXVertexList const& scope) {
-    ZXGraph copied_graph = *graph;
-    scoped_full_reduce(&copied_graph, scope);
-    auto const optimal_t_count = copied_graph.t_count();
-
     auto simplifier = Simplifier(graph);
 
-    scoped_interior_clifford_simp(graph, scope);
+    // the T-count reached by a full reduction, which is then rolled back
+    graph->checkpoint();
+    scoped_full_reduce(simplifier, scope);
+    auto const optimal_t_count = graph->t_count();
+    graph->rollback();
+
+    scoped_interior_clifford_simp(simplifier, scope);
     simplifier.scoped_simplify(PivotGadgetRule(), scope);
     if (graph->t_count() <= optimal_t_count) return;
 
     while (!stop_requested()) {
-        scoped_clifford_simp(graph, scope);
+        scoped_clifford_simp(simplifier, scope);
         if (graph->t_count() <= optimal_t_count) return;
-        auto const i1 = simplifier.scoped_simplify(PhaseGadgetRule(), scope);
+        auto const i1 = simplifier.scoped_simplify(PhaseGadgetRule(simplifier.get_match_arena<PhaseGadgetRule>()), scope);
         if (graph->t_count() <= optimal_t_count) return;
-        scoped_interior_clifford_simp(graph, scope);
+        scoped_interior_clifford_simp(simplifier, scope);
         if (graph->t_count() <= optimal_t_count) return;
         auto const i2 = simplifier.scoped_simplify(PivotGadgetRule(), scope);
         if (graph->t_count() <= optimal_t_count) return;
@@ -63,39 +108,39 @@ void scoped_dynamic_reduce(ZXGraph* graph, ZXVertexList const& scope) {
 
 void scoped_full_reduce(ZXGraph* graph, ZXVertexList const& scope) {
     auto simplifier = Simplifier(graph);
+    scoped_full_reduce(simplifier, scope);
+}
 
-    scoped_interior_clifford_simp(graph, scope);
+void scoped_full_reduce(Simplifier& simplifier, ZXVertexList const& scope) {
+    scoped_interior_clifford_simp(simplifier, scope);
     simplifier.scoped_simplify(PivotGadgetRule(), scope);
     while (!stop_requested()) {
-        scoped_clifford_simp(graph, scope);
-        auto const i1 = simplifier.scoped_simplify(PhaseGadgetRule(), scope);
-        scoped_interior_clifford_simp(graph, scope);
+        scoped_clifford_simp(simplifier, scope);
+        auto const i1 = simplifier.scoped_simplify(PhaseGadgetRule(simplifier.get_match_arena<PhaseGadgetRule>()), scope);
+        scoped_interior_clifford_simp(simplifier, scope);
         auto const i2 = simplifier.scoped_simplify(PivotGadgetRule(), scope);
         if (i1 + i2 == 0) break;
     }
 }
 
-size_t scoped_interior_clifford_simp(ZXGraph* graph, ZXVertexList const& scope) {
-    auto simplifier = Simplifier(graph);
-
+size_t scoped_interior_clifford_simp(Simplifier& simplifier, ZXVertexList const& scope) {
     simplifier.scoped_simplify(SpiderFusionRule(), scope);
-    simplifier.to_z_graph();
-    for (size_t iterations = 0; !stop_requested(); iterations++) {
+    simplifier.scoped_to_z_graph(scope);
+    size_t iterations = 0;
+    for (; !stop_requested(); iterations++) {
         auto const i1 = simplifier.scoped_simplify(IdentityRemovalRule(), scope);
         auto const i2 = simplifier.scoped_simplify(SpiderFusionRule(), scope);
         auto const i3 = simplifier.scoped_simplify(PivotRule(), scope);
-        auto const i4 = simplifier.scoped_simplify(LocalComplementRule(), scope);
-        if (i1 + i2 + i3 + i4 == 0) return iterations;
+        auto const i4 = simplifier.scoped_simplify(LocalComplementRule(simplifier.get_match_arena<LocalComplementRule>()), scope);
+        if (i1 + i2 + i3 + i4 == 0) break;
     }
-    DVLAB_UNREACHABLE("This line should not be reached");
+    return iterations;
 }
 
-size_t scoped_clifford_simp(ZXGraph* graph, ZXVertexList const& scope) {
-    auto simplifier = Simplifier(graph);
-
+size_t scoped_clifford_simp(Simplifier& simplifier, ZXVertexList const& scope) {
     size_t iteration = 0;
     while (true) {
-        auto i1 = scoped_interior_clifford_simp(graph, scope);
+        auto i1 = scoped_interior_clifford_simp(simplifier, scope);
         iteration += i1;
         auto i2 = simplifier.scoped_simplify(PivotBoundaryRule(), scope);
         if (i2 == 0) break;
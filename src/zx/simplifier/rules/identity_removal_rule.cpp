@@ -5,6 +5,10 @@
   Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
 ****************************************************************************/
 
+#include <optional>
+#include <ranges>
+#include <unordered_set>
+
 #include "./zx_rules_template.hpp"
 #include "zx/zxgraph.hpp"
 
@@ -12,27 +16,41 @@ using namespace qsyn::zx;
 
 using MatchType = IdentityRemovalRule::MatchType;
 
+namespace qsyn::zx {
+
+namespace {
+
 /**
- * @brief Find all the matches of the identity removal rule.
+ * @brief Match the identity removal rule at `v` as if no vertex were taken.
  *
- * @param g The graph to be simplified.
+ * @param graph The graph to be simplified.
+ * @param v The vertex to be removed.
  */
-std::vector<MatchType> IdentityRemovalRule::find_matches(ZXGraph const& graph) const {
+std::optional<MatchType> propose_identity_removal(ZXGraph const& graph, ZXVertex* v) {
+    if (v->get_phase() != Phase(0)) return std::nullopt;
+    if (v->get_type() != VertexType::z && v->get_type() != VertexType::x) return std::nullopt;
+    if (graph.get_num_neighbors(v) != 2) return std::nullopt;
+
+    auto [n0, etype0] = graph.get_first_neighbor(v);
+    auto [n1, etype1] = graph.get_second_neighbor(v);
+
+    return MatchType{v, n0, n1, zx::concat_edge(etype0, etype1)};
+}
+
+/**
+ * @brief Keep the proposed matches whose removed vertex is not taken by an earlier one.
+ *
+ * @param proposals The proposed matches, in the order of the scan.
+ */
+std::vector<MatchType> resolve_identity_removal_matches(std::ranges::input_range auto const& proposals) {
     std::vector<MatchType> matches;
 
     std::unordered_set<ZXVertex*> taken;
 
-    for (auto const& v : graph.get_vertices()) {
+    for (auto const& [v, n0, n1, edge_type] : proposals) {
         if (taken.contains(v)) continue;
 
-        if (v->get_phase() != Phase(0)) continue;
-        if (v->get_type() != VertexType::z && v->get_type() != VertexType::x) continue;
-        if (graph.get_num_neighbors(v) != 2) continue;
-
-        auto [n0, etype0] = graph.get_first_neighbor(v);
-        auto [n1, etype1] = graph.get_second_neighbor(v);
-
-        matches.emplace_back(v, n0, n1, zx::concat_edge(etype0, etype1));
+        matches.emplace_back(v, n0, n1, edge_type);
         taken.insert(v);
         taken.insert(n0);
         taken.insert(n1);
@@ -41,6 +59,35 @@ std::vector<MatchType> IdentityRemovalRule::find_matches(ZXGraph const& graph) c
     return matches;
 }
 
+}  // namespace
+
+}  // namespace qsyn::zx
+
+/**
+ * @brief Find all the matches of the identity removal rule.
+ *
+ * @param g The graph to be simplified.
+ */
+std::vector<MatchType> IdentityRemovalRule::find_matches(ZXGraph const& graph) const {
+    return resolve_identity_removal_matches(propose_at_vertices(graph, [&graph](ZXVertex* v) {
+        return propose_identity_removal(graph, v);
+    }));
+}
+
+/**
+ * @brief Find the matches of the identity removal rule that remove one of the candidates.
+ *
+ * @param graph The graph to be simplified.
+ * @param candidates The vertices to look at.
+ */
+std::vector<MatchType> IdentityRemovalRule::find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const {
+    std::vector<MatchType> proposals;
+    for (auto const& v : candidates) {
+        if (auto const proposal = propose_identity_removal(graph, v)) proposals.emplace_back(*proposal);
+    }
+    return resolve_identity_removal_matches(proposals);
+}
+
 /**
  * @brief Apply the identity removal rule to the graph.
  *
@@ -5,73 +5,143 @@
   Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
 ****************************************************************************/
 
+#include <algorithm>
 #include <gsl/narrow>
+#include <numeric>
+#include <optional>
+#include <ranges>
 #include <unordered_set>
 #include <utility>
 
 #include "./zx_rules_template.hpp"
+#include "tl/enumerate.hpp"
 
 using namespace qsyn::zx;
 
 using MatchType = LocalComplementRule::MatchType;
 
+namespace qsyn::zx {
+
+namespace {
+
 /**
- * @brief Find noninteracting matchings of the local complementation rule.
+ * @brief Check if the local complementation rule matches `v` when no vertex is taken yet.
  *
  * @param graph The graph to find matches in.
+ * @param v The vertex to complement around.
  */
-std::vector<MatchType> LocalComplementRule::find_matches(ZXGraph const& graph) const {
+std::optional<ZXVertex*> propose_local_complement(ZXGraph const& graph, ZXVertex* v) {
+    if (!v->is_z() || (v->get_phase() != Phase(1, 2) && v->get_phase() != Phase(3, 2))) return std::nullopt;
+    for (auto const& [nb, etype] : graph.get_neighbors(v)) {
+        if (etype != EdgeType::hadamard || !nb->is_z()) return std::nullopt;
+    }
+    return v;
+}
+
+/**
+ * @brief Keep the proposed matches that do not interact with an earlier one.
+ *
+ * @param graph The graph to find matches in.
+ * @param proposals The vertices to complement around, in the order of the scan.
+ * @param arena The arena to store the neighbors in the matches.
+ */
+std::vector<MatchType> resolve_local_complement_matches(ZXGraph const& graph, std::ranges::input_range auto const& proposals, MatchArena& arena) {
     std::vector<MatchType> matches;
 
     std::unordered_set<ZXVertex*> taken;
+    // the neighbors are taken by the match, so each vertex is in at most one list
+    arena.reset(graph.get_num_vertices());
 
-    for (auto const& v : graph.get_vertices()) {
-        if (v->get_type() == VertexType::z && (v->get_phase() == Phase(1, 2) || v->get_phase() == Phase(3, 2))) {
-            bool match_condition = true;
-            if (taken.contains(v)) continue;
+    for (auto const& v : proposals) {
+        if (taken.contains(v)) continue;
+        if (std::ranges::any_of(graph.get_neighbors(v), [&taken](NeighborPair const& nbp) { return taken.contains(nbp.first); })) continue;
 
-            for (auto const& [nb, etype] : graph.get_neighbors(v)) {
-                if (etype != EdgeType::hadamard || nb->get_type() != VertexType::z || taken.contains(nb)) {
-                    match_condition = false;
-                    break;
-                }
-            }
-            if (match_condition) {
-                std::vector<ZXVertex*> neighbors;
-                for (auto const& [nb, _] : graph.get_neighbors(v)) {
-                    if (v == nb) continue;
-                    neighbors.emplace_back(nb);
-                    taken.insert(nb);
-                }
-                taken.insert(v);
-                matches.emplace_back(make_pair(v, neighbors));
-            }
+        auto const list_begin = arena.size();
+        for (auto const& [nb, _] : graph.get_neighbors(v)) {
+            if (v == nb) continue;
+            arena.push_back(nb);
+            taken.insert(nb);
         }
+        taken.insert(v);
+        matches.emplace_back(v, arena.list_from(list_begin));
     }
 
     return matches;
 }
 
+}  // namespace
+
+}  // namespace qsyn::zx
+
+/**
+ * @brief Find noninteracting matchings of the local complementation rule.
+ *
+ * @param graph The graph to find matches in.
+ */
+std::vector<MatchType> LocalComplementRule::find_matches(ZXGraph const& graph) const {
+    auto const proposals = propose_at_vertices(graph, [&graph](ZXVertex* v) {
+        return propose_local_complement(graph, v);
+    });
+    return resolve_local_complement_matches(graph, proposals, *_arena);
+}
+
+/**
+ * @brief Find noninteracting matchings of the local complementation rule that complement around one of the candidates.
+ *
+ * @param graph The graph to find matches in.
+ * @param candidates The vertices to look at.
+ */
+std::vector<MatchType> LocalComplementRule::find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const {
+    std::vector<ZXVertex*> proposals;
+    for (auto const& v : candidates) {
+        if (propose_local_complement(graph, v)) proposals.emplace_back(v);
+    }
+    return resolve_local_complement_matches(graph, proposals, *_arena);
+}
+
 void LocalComplementRule::apply(ZXGraph& graph, std::vector<MatchType> const& matches) const {
-    ZXOperation op;
+    // the matches do not interact, so the phases and the edges to add are computed in parallel
+    std::vector<Phase> phases(matches.size());
+    std::vector<std::vector<EdgePair>> edges_to_add(matches.size());
 
-    for (auto const& [v, neighbors] : matches) {
-        op.vertices_to_remove.emplace_back(v);
-        size_t h_edge_count = 0;
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < matches.size(); ++i) {
+        auto const& [v, neighbors] = matches[i];
+        size_t h_edge_count        = 0;
         for (auto& [nb, etype] : graph.get_neighbors(v)) {
             if (nb == v && etype == EdgeType::hadamard) {
                 h_edge_count++;
             }
         }
-        auto const p = v->get_phase() + Phase(gsl::narrow<int>(h_edge_count / 2));
+        phases[i] = v->get_phase() + Phase(gsl::narrow<int>(h_edge_count / 2));
         // TODO: global scalar ignored
+        if (neighbors.size() >= dense_neighborhood_threshold) continue;
         for (size_t n = 0; n < neighbors.size(); n++) {
-            neighbors[n]->set_phase(neighbors[n]->get_phase() - p);
             for (size_t j = n + 1; j < neighbors.size(); j++) {
-                op.edges_to_add.emplace_back(std::make_pair(neighbors[n], neighbors[j]), EdgeType::hadamard);
+                edges_to_add[i].emplace_back(std::make_pair(neighbors[n], neighbors[j]), EdgeType::hadamard);
             }
         }
     }
 
+    ZXOperation op;
+
+    for (auto const& [i, match] : tl::views::enumerate(matches)) {
+        auto const& [v, neighbors] = match;
+        op.vertices_to_remove.emplace_back(v);
+        for (auto const& nb : neighbors) {
+            nb->set_phase(nb->get_phase() - phases[i]);
+        }
+        if (neighbors.size() < dense_neighborhood_threshold) {
+            op.edges_to_add.insert(op.edges_to_add.end(), edges_to_add[i].begin(), edges_to_add[i].end());
+            continue;
+        }
+        // add the pending edges first so that each neighbor set is toggled in the same order
+        graph.add_edges(op.edges_to_add);
+        op.edges_to_add.clear();
+        std::vector<size_t> parts(neighbors.size());
+        std::iota(parts.begin(), parts.end(), 0);
+        graph.complement_hadamard_edges(neighbors, parts);
+    }
+
     _update(graph, op);
 }
@@ -5,7 +5,11 @@
   Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
 ****************************************************************************/
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
 #include <ranges>
+#include <vector>
 
 #include "./zx_rules_template.hpp"
 #include "zx/zxgraph.hpp"
@@ -14,76 +18,110 @@ using namespace qsyn::zx;
 
 using MatchType = PhaseGadgetRule::MatchType;
 
-struct ZXVerticesHash {
-    size_t operator()(std::vector<ZXVertex*> const& k) const {
-        size_t ret = std::hash<ZXVertex*>()(k[0]);
-        for (size_t i = 1; i < k.size(); i++) {
-            ret ^= std::hash<ZXVertex*>()(k[i]);
-        }
+namespace {
 
-        return ret;
-    }
+// a non-Clifford leaf connected to an axel with a phase of 0 or pi
+struct Gadget {
+    ZXVertex* axel;
+    ZXVertex* leaf;
+    size_t position;   // the order in which the leaf is scanned
+    size_t signature;  // see `ZXGraph::get_gadget_group_signature`
 };
 
+size_t num_edges_between(ZXGraph const& graph, ZXVertex* v0, ZXVertex* v1) {
+    return static_cast<size_t>(graph.is_neighbor(v0, v1, EdgeType::simple)) + static_cast<size_t>(graph.is_neighbor(v0, v1, EdgeType::hadamard));
+}
+
+/**
+ * @brief Check if the gadgets act on the same vertices, i.e., the neighbors of the axels other than
+ *        the leaves are the same. The leaf of a gadget cannot neighbor the axel of another one.
+ *
+ */
+bool act_on_same_vertices(ZXGraph const& graph, Gadget const& a, Gadget const& b) {
+    return graph.get_num_neighbors(a.axel) == graph.get_num_neighbors(b.axel) &&
+           std::ranges::all_of(graph.get_neighbors(a.axel), [&](NeighborPair const& nbp) {
+               return nbp.first == a.leaf || num_edges_between(graph, a.axel, nbp.first) == num_edges_between(graph, b.axel, nbp.first);
+           });
+}
+
+}  // namespace
+
 /**
  * @brief Determine which phase gadgets act on the same vertices, so that they can be fused together.
+ *        The gadgets are grouped by the signatures kept by the graph, and the neighbors of the axels
+ *        are compared only within a group, so grouping takes time linear in the total gadget degree.
+ *        The gadget index of the graph must be up to date, see `ZXGraph::update_gadget_index`.
  *
  * @param graph The graph to find matches in.
  */
 std::vector<MatchType> PhaseGadgetRule::find_matches(ZXGraph const& graph) const {
     std::vector<MatchType> matches;
 
-    std::unordered_map<ZXVertex*, ZXVertex*> axel2leaf;
-    std::unordered_multimap<std::vector<ZXVertex*>, ZXVertex*, ZXVerticesHash> group2axel;
-
-    std::vector<ZXVertex*> axels;
-    std::vector<ZXVertex*> leaves;
-    for (auto const& v : graph.get_vertices()) {
-        if (v->get_phase().denominator() <= 2 || graph.get_num_neighbors(v) != 1) continue;
+    std::vector<Gadget> gadgets;
+    // look for the non-Clifford leaves in the attribute arrays to avoid touching every vertex
+    auto const& attributes = graph.get_vertex_attributes();
+    for (size_t i = 0; i < attributes.size(); ++i) {
+        if (attributes.phase_denominators[i] <= 2 || attributes.degrees[i] != 1 || attributes.types[i] == VertexType::boundary) continue;
 
-        ZXVertex* nb = graph.get_first_neighbor(v).first;
+        ZXVertex* const v = attributes.vertices[i];
+        ZXVertex* nb      = graph.get_first_neighbor(v).first;
 
         if (nb->get_phase().denominator() != 1) continue;
         if (nb->is_boundary()) continue;
-        if (axel2leaf.contains(nb)) continue;
+        // the gadget acts on no vertex
+        if (graph.get_num_neighbors(nb) == 1) continue;
 
-        axel2leaf[nb] = v;
+        gadgets.push_back(Gadget{nb, v, gadgets.size(), graph.get_gadget_group_signature(v)});
+    }
 
-        std::vector<ZXVertex*> group;
+    // an axel with several leaves is a gadget of the first leaf only
+    std::ranges::stable_sort(gadgets, std::less{}, &Gadget::axel);
+    auto const duplicates = std::ranges::unique(gadgets, {}, &Gadget::axel);
+    gadgets.erase(duplicates.begin(), duplicates.end());
+
+    // the fused gadget keeps the axel and the leaf scanned last
+    std::ranges::sort(gadgets, [](Gadget const& a, Gadget const& b) {
+        return a.signature != b.signature ? a.signature < b.signature : a.position > b.position;
+    });
+
+    // the axels and the leaves are all distinct
+    _arena->reset(graph.get_num_vertices());
+    for (auto bucket_begin = gadgets.begin(); bucket_begin != gadgets.end();) {
+        auto const bucket_end = std::find_if(bucket_begin, gadgets.end(), [&bucket_begin](Gadget const& gadget) {
+            return gadget.signature != bucket_begin->signature;
+        });
+        // a bucket holds a single group unless the signatures collide
+        while (bucket_begin != bucket_end) {
+            auto const is_same_group = [&graph, &first = *bucket_begin](Gadget const& gadget) {
+                return act_on_same_vertices(graph, first, gadget);
+            };
+            auto group_end = std::find_if_not(std::next(bucket_begin), bucket_end, is_same_group);
+            if (group_end != bucket_end) group_end = std::stable_partition(group_end, bucket_end, is_same_group);
+            auto const same_group = std::ranges::subrange(bucket_begin, group_end);
+            bucket_begin          = group_end;
+
+            auto total_phase = Phase(0);
+            bool flip_axel   = false;
+
+            auto const axels_begin = _arena->size();
+            for (auto const& gadget : same_group) {
+                if (gadget.axel->get_phase() == Phase(1)) {
+                    flip_axel = true;
+                    gadget.axel->set_phase(Phase(0));
+                    gadget.leaf->set_phase((-1) * gadget.leaf->get_phase());
+                }
+                total_phase += gadget.leaf->get_phase();
+                _arena->push_back(gadget.axel);
+            }
+            auto const axels = _arena->list_from(axels_begin);
 
-        for (auto& [nb2, _] : graph.get_neighbors(nb)) {
-            if (nb2 != v) group.emplace_back(nb2);
-        }
+            auto const leaves_begin = _arena->size();
+            for (auto const& gadget : same_group) _arena->push_back(gadget.leaf);
+            auto const leaves = _arena->list_from(leaves_begin);
 
-        if (group.size() > 0) {
-            std::ranges::sort(group);
-            group2axel.emplace(group, nb);
-        }
-    }
-    auto itr = std::begin(group2axel);
-    while (itr != group2axel.end()) {
-        auto [groupBegin, groupEnd] = group2axel.equal_range(itr->first);
-        itr                         = groupEnd;
-
-        axels.clear();
-        leaves.clear();
-
-        auto total_phase = Phase(0);
-        bool flip_axel   = false;
-        for (auto& [_, axel] : std::ranges::subrange(groupBegin, groupEnd)) {
-            ZXVertex* const& leaf = axel2leaf[axel];
-            if (axel->get_phase() == Phase(1)) {
-                flip_axel = true;
-                axel->set_phase(Phase(0));
-                leaf->set_phase((-1) * axel2leaf[axel]->get_phase());
+            if (leaves.size() > 1 || flip_axel) {
+                matches.emplace_back(total_phase, axels, leaves);
             }
-            total_phase += axel2leaf[axel]->get_phase();
-            axels.emplace_back(axel);
-            leaves.emplace_back(axel2leaf[axel]);
-        }
-
-        if (leaves.size() > 1 || flip_axel) {
-            matches.emplace_back(total_phase, axels, leaves);
         }
     }
 
@@ -94,10 +132,8 @@ void PhaseGadgetRule::apply(ZXGraph& graph, std::vector<MatchType> const& matche
     ZXOperation op;
 
     for (auto& match : matches) {
-        Phase const& new_phase                  = get<0>(match);
-        std::vector<ZXVertex*> const& rm_axels  = get<1>(match);
-        std::vector<ZXVertex*> const& rm_leaves = get<2>(match);
-        ZXVertex* leaf                          = rm_leaves[0];
+        auto const& [new_phase, rm_axels, rm_leaves] = match;
+        ZXVertex* leaf                                = rm_leaves[0];
         leaf->set_phase(new_phase);
         op.vertices_to_remove.insert(std::end(op.vertices_to_remove), std::begin(rm_axels) + 1, std::end(rm_axels));
         op.vertices_to_remove.insert(std::end(op.vertices_to_remove), std::begin(rm_leaves) + 1, std::end(rm_leaves));
@@ -5,71 +5,92 @@
   Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
 ****************************************************************************/
 
+#include <optional>
+#include <unordered_set>
+#include <utility>
+
 #include "./zx_rules_template.hpp"
 
 using namespace qsyn::zx;
 
 using MatchType = PivotGadgetRule::MatchType;
 
-std::vector<MatchType> PivotGadgetRule::find_matches(ZXGraph const& graph) const {
-    std::vector<MatchType> matches;
+namespace {
 
-    std::unordered_set<ZXVertex*> taken;
+// What the scan does at an edge whose ends are not taken yet: take `first` and `second`,
+// either of which may be nullptr, and match them if `is_match`, taking their neighbors too
+struct PivotGadgetProposal {
+    std::pair<ZXVertex*, ZXVertex*> ends;
+    ZXVertex* first;
+    ZXVertex* second;
+    bool is_match;
+};
 
-    graph.for_each_edge([&graph, &taken, &matches](EdgePair const& epair) {
-        if (epair.second != EdgeType::hadamard) return;
+/**
+ * @brief Check the pivot gadget rule on `epair` as if no vertex were taken.
+ *
+ */
+std::optional<PivotGadgetProposal> propose_pivot_gadget(ZXGraph const& graph, EdgePair const& epair) {
+    if (epair.second != EdgeType::hadamard) return std::nullopt;
 
-        ZXVertex* vs = epair.first.first;
-        ZXVertex* vt = epair.first.second;
+    ZXVertex* vs = epair.first.first;
+    ZXVertex* vt = epair.first.second;
 
-        if (taken.contains(vs) || taken.contains(vt)) return;
+    if (!vs->is_z()) return PivotGadgetProposal{epair.first, vs, nullptr, false};
+    if (!vt->is_z()) return PivotGadgetProposal{epair.first, vt, nullptr, false};
 
-        if (!vs->is_z()) {
-            taken.insert(vs);
-            return;
-        }
-        if (!vt->is_z()) {
-            taken.insert(vt);
-            return;
-        }
+    auto const vs_is_n_pi = (vs->get_phase().denominator() == 1);
+    auto const vt_is_n_pi = (vt->get_phase().denominator() == 1);
 
-        auto const vs_is_n_pi = (vs->get_phase().denominator() == 1);
-        auto const vt_is_n_pi = (vt->get_phase().denominator() == 1);
+    // if both n*pi --> ordinary pivot rules
+    // if both not, --> maybe pivot double-boundary
+    if (vs_is_n_pi == vt_is_n_pi) return std::nullopt;
 
-        // if both n*pi --> ordinary pivot rules
-        // if both not, --> maybe pivot double-boundary
-        if (vs_is_n_pi == vt_is_n_pi) return;
+    if (!vs_is_n_pi && vt_is_n_pi) std::swap(vs, vt);  // if vs is not n*pi but vt is, should extract vs as gadget instead
 
-        if (!vs_is_n_pi && vt_is_n_pi) std::swap(vs, vt);  // if vs is not n*pi but vt is, should extract vs as gadget instead
+    // REVIEW - check ground conditions
 
-        // REVIEW - check ground conditions
+    if (graph.get_num_neighbors(vt) == 1) {  // early return: (vs, vt) is a phase gadget
+        return PivotGadgetProposal{epair.first, vs, vt, false};
+    }
 
-        if (graph.get_num_neighbors(vt) == 1) {  // early return: (vs, vt) is a phase gadget
-            taken.insert(vs);
-            taken.insert(vt);
-            return;
+    // the Z-neighbors of degree 1 are exactly the gadget leaves, so only an axel needs the degree check
+    auto const vs_is_axel = graph.get_num_gadget_leaves(vs) > 0;
+    for (const auto& [v, _] : graph.get_neighbors(vs)) {
+        if (!v->is_z()) return std::nullopt;                  // vs is not internal or not graph-like
+        if (vs_is_axel && graph.get_num_neighbors(v) == 1) {  // (vs, v) is a phase gadget
+            return PivotGadgetProposal{epair.first, vs, v, false};
         }
+    }
+    for (const auto& [v, _] : graph.get_neighbors(vt)) {
+        if (!v->is_z()) return std::nullopt;  // vt is not internal or not graph-like
+    }
 
-        for (const auto& [v, _] : graph.get_neighbors(vs)) {
-            if (!v->is_z()) return;                 // vs is not internal or not graph-like
-            if (graph.get_num_neighbors(v) == 1) {  // (vs, v) is a phase gadget
-                taken.insert(vs);
-                taken.insert(v);
-                return;
-            }
-        }
-        for (const auto& [v, _] : graph.get_neighbors(vt)) {
-            if (!v->is_z()) return;  // vt is not internal or not graph-like
-        }
+    // Both vs and vt are interior vertices
+    return PivotGadgetProposal{epair.first, vs, vt, true};
+}
+
+}  // namespace
+
+std::vector<MatchType> PivotGadgetRule::find_matches(ZXGraph const& graph) const {
+    std::vector<MatchType> matches;
 
-        // Both vs and vt are interior vertices
-        taken.insert(vs);
-        taken.insert(vt);
-        for (auto& [v, _] : graph.get_neighbors(vs)) taken.insert(v);
-        for (auto& [v, _] : graph.get_neighbors(vt)) taken.insert(v);
+    std::unordered_set<ZXVertex*> taken;
 
-        matches.emplace_back(vs, vt);
+    auto const proposals = propose_at_edges(graph, [&graph](EdgePair const& epair) {
+        return propose_pivot_gadget(graph, epair);
     });
+    for (auto const& [ends, first, second, is_match] : proposals) {
+        if (taken.contains(ends.first) || taken.contains(ends.second)) continue;
+
+        taken.insert(first);
+        if (second != nullptr) taken.insert(second);
+        if (!is_match) continue;
+
+        for (auto& [v, _] : graph.get_neighbors(first)) taken.insert(v);
+        for (auto& [v, _] : graph.get_neighbors(second)) taken.insert(v);
+        matches.emplace_back(first, second);
+    }
 
     return matches;
 }
@@ -5,12 +5,87 @@
   Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
 ****************************************************************************/
 
+#include <optional>
+#include <unordered_set>
+
 #include "./zx_rules_template.hpp"
 
 using namespace qsyn::zx;
 
 using MatchType = PivotRule::MatchType;
 
+namespace qsyn::zx {
+
+namespace {
+
+// What the scan does at an edge whose ends are not taken yet: take `blocker` if it is not
+// nullptr, otherwise match the edge
+struct PivotProposal {
+    ZXVertex* vs;
+    ZXVertex* vt;
+    ZXVertex* blocker;
+};
+
+/**
+ * @brief Check the pivot rule on `epair` as if no vertex were taken.
+ *
+ */
+std::optional<PivotProposal> propose_pivot(ZXGraph const& graph, EdgePair const& epair) {
+    if (epair.second != EdgeType::hadamard) return std::nullopt;
+
+    // 2: Get Neighbors
+    auto [vs, vt] = epair.first;
+
+    if (!vs->is_z() || !vt->is_z()) return std::nullopt;
+
+    // 3: Check Neighbors Phase
+    if (!vs->has_n_pi_phase() || !vt->has_n_pi_phase()) return std::nullopt;
+
+    // 4: Check neighbors of Neighbors
+
+    bool found_one = false;
+    for (auto& v : {vs, vt}) {
+        for (auto& [nb, et] : graph.get_neighbors(v)) {
+            if (nb->is_z() && et == EdgeType::hadamard) continue;
+            if (nb->is_boundary()) {
+                if (found_one) return std::nullopt;
+                found_one = true;
+            } else {
+                return PivotProposal{vs, vt, nb};
+            }
+        }
+    }
+
+    return PivotProposal{vs, vt, nullptr};
+}
+
+/**
+ * @brief Carry out the proposal if it does not interact with the matches found so far.
+ *
+ */
+void resolve_pivot(ZXGraph const& graph, PivotProposal const& proposal, std::unordered_set<ZXVertex*>& taken, std::vector<MatchType>& matches) {
+    auto const [vs, vt, blocker] = proposal;
+    if (taken.contains(vs) || taken.contains(vt)) return;
+
+    if (blocker != nullptr) {
+        taken.insert(blocker);
+        return;
+    }
+
+    // 5: taken
+    taken.insert(vs);
+    taken.insert(vt);
+    for (auto& [v, _] : graph.get_neighbors(vs)) taken.insert(v);
+    for (auto& [v, _] : graph.get_neighbors(vt)) taken.insert(v);
+
+    // 6: add Epair into _matchTypeVec
+    matches.emplace_back(vs, vt);
+}
+
+}  // namespace
+
+}  // namespace qsyn::zx
+
 /**
  * @brief Finds matchings of the pivot rule.
  *
@@ -20,42 +95,30 @@ std::vector<MatchType> PivotRule::find_matches(ZXGraph const& graph) const {
     std::vector<MatchType> matches;
 
     std::unordered_set<ZXVertex*> taken;
-    graph.for_each_edge([&graph, &taken, &matches](EdgePair const& epair) {
-        if (epair.second != EdgeType::hadamard) return;
-
-        // 2: Get Neighbors
-        auto [vs, vt] = epair.first;
-
-        if (taken.contains(vs) || taken.contains(vt)) return;
-        if (!vs->is_z() || !vt->is_z()) return;
+    auto const proposals = propose_at_edges(graph, [&graph](EdgePair const& epair) {
+        return propose_pivot(graph, epair);
+    });
+    for (auto const& proposal : proposals) {
+        resolve_pivot(graph, proposal, taken, matches);
+    }
 
-        // 3: Check Neighbors Phase
-        if (!vs->has_n_pi_phase() || !vt->has_n_pi_phase()) return;
+    return matches;
+}
 
-        // 4: Check neighbors of Neighbors
+/**
+ * @brief Finds matchings of the pivot rule on the edges incident to the candidates.
+ *
+ * @param graph The graph to find matches
+ * @param candidates The vertices to look at
+ */
+std::vector<MatchType> PivotRule::find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const {
+    std::vector<MatchType> matches;
 
-        bool found_one = false;
-        for (auto& v : {vs, vt}) {
-            for (auto& [nb, et] : graph.get_neighbors(v)) {
-                if (nb->is_z() && et == EdgeType::hadamard) continue;
-                if (nb->is_boundary()) {
-                    if (found_one) return;
-                    found_one = true;
-                } else {
-                    taken.insert(nb);
-                    return;
-                }
-            }
+    std::unordered_set<ZXVertex*> taken;
+    graph.for_each_incident_edge(candidates, [&graph, &taken, &matches](EdgePair const& epair) {
+        if (auto const proposal = propose_pivot(graph, epair)) {
+            resolve_pivot(graph, *proposal, taken, matches);
         }
-
-        // 5: taken
-        taken.insert(vs);
-        taken.insert(vt);
-        for (auto& [v, _] : graph.get_neighbors(vs)) taken.insert(v);
-        for (auto& [v, _] : graph.get_neighbors(vt)) taken.insert(v);
-
-        // 6: add Epair into _matchTypeVec
-        matches.emplace_back(vs, vt);
     });
 
     return matches;
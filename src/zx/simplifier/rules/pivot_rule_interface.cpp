@@ -5,17 +5,23 @@
   Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
 ****************************************************************************/
 
+#include <array>
+
 #include "./zx_rules_template.hpp"
+#include "tl/enumerate.hpp"
 
 using namespace qsyn::zx;
 
 void PivotRuleInterface::apply(ZXGraph& graph, std::vector<MatchType> const& matches) const {
-    ZXOperation op;
+    // the matches do not interact, so the neighborhoods and the edges to add are computed in parallel
+    std::vector<std::array<std::vector<ZXVertex*>, 3>> neighborhoods(matches.size());
+    std::vector<std::vector<EdgePair>> edges_to_add(matches.size());
 
-    for (auto& m : matches) {
-        auto [m0, m1] = m;
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < matches.size(); ++i) {
+        auto [m0, m1]      = matches[i];
+        auto& [n0, n1, n2] = neighborhoods[i];
 
-        std::vector<ZXVertex*> n0, n1, n2;
         std::vector<ZXVertex*> m0_neighbors = graph.get_copied_neighbors(m0);
         std::vector<ZXVertex*> m1_neighbors = graph.get_copied_neighbors(m1);
 
@@ -34,22 +40,46 @@ void PivotRuleInterface::apply(ZXGraph& graph, std::vector<MatchType> const& mat
         set_difference(std::begin(m0_neighbors), std::end(m0_neighbors), std::begin(n2), std::end(n2), back_inserter(n0), vid_less_than);
         set_difference(std::begin(m1_neighbors), std::end(m1_neighbors), std::begin(n2), std::end(n2), back_inserter(n1), vid_less_than);
 
+        if (n0.size() + n1.size() + n2.size() >= dense_neighborhood_threshold) continue;
+
         // Add edge table
         for (auto const& s : n0) {
             for (auto const& t : n1) {
                 assert(s->get_id() != t->get_id());
-                op.edges_to_add.emplace_back(std::make_pair(s, t), EdgeType::hadamard);
+                edges_to_add[i].emplace_back(std::make_pair(s, t), EdgeType::hadamard);
             }
             for (auto const& t : n2) {
                 assert(s->get_id() != t->get_id());
-                op.edges_to_add.emplace_back(std::make_pair(s, t), EdgeType::hadamard);
+                edges_to_add[i].emplace_back(std::make_pair(s, t), EdgeType::hadamard);
             }
         }
         for (auto const& s : n1) {
             for (auto const& t : n2) {
                 assert(s->get_id() != t->get_id());
-                op.edges_to_add.emplace_back(std::make_pair(s, t), EdgeType::hadamard);
+                edges_to_add[i].emplace_back(std::make_pair(s, t), EdgeType::hadamard);
+            }
+        }
+    }
+
+    ZXOperation op;
+
+    for (auto const& [i, m] : tl::views::enumerate(matches)) {
+        auto [m0, m1]            = m;
+        auto const& [n0, n1, n2] = neighborhoods[i];
+
+        if (n0.size() + n1.size() + n2.size() < dense_neighborhood_threshold) {
+            op.edges_to_add.insert(op.edges_to_add.end(), edges_to_add[i].begin(), edges_to_add[i].end());
+        } else {
+            // add the pending edges first so that each neighbor set is toggled in the same order
+            graph.add_edges(op.edges_to_add);
+            op.edges_to_add.clear();
+            std::vector<ZXVertex*> vertices;
+            std::vector<size_t> parts;
+            for (auto const& [part, neighborhood] : tl::views::enumerate(neighborhoods[i])) {
+                vertices.insert(vertices.end(), neighborhood.begin(), neighborhood.end());
+                parts.insert(parts.end(), neighborhood.size(), part);
             }
+            graph.complement_hadamard_edges(vertices, parts);
         }
 
         // REVIEW - check if not ground
@@ -5,12 +5,50 @@
   Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
 ****************************************************************************/
 
+#include <optional>
+#include <unordered_set>
+
 #include "./zx_rules_template.hpp"
 
 using namespace qsyn::zx;
 
 using MatchType = SpiderFusionRule::MatchType;
 
+namespace qsyn::zx {
+
+namespace {
+
+/**
+ * @brief Check if the spider fusion rule matches `epair` when no vertex is taken yet.
+ *
+ */
+std::optional<MatchType> propose_spider_fusion(EdgePair const& epair) {
+    auto const [v0, v1] = epair.first;  // v1 is to be merged to v0
+    if (epair.second != EdgeType::simple || v0->get_type() != v1->get_type() || (!v0->is_x() && !v0->is_z())) return std::nullopt;
+    return MatchType{v0, v1};
+}
+
+/**
+ * @brief Match the proposal if it does not interact with the matches found so far.
+ *
+ */
+void resolve_spider_fusion(ZXGraph const& graph, MatchType const& proposal, std::unordered_set<ZXVertex*>& taken, std::vector<MatchType>& matches) {
+    auto const [v0, v1] = proposal;
+    if (taken.contains(v0) || taken.contains(v1)) return;
+
+    taken.insert(v0);
+    taken.insert(v1);
+    // NOTE: Cannot choose the vertex connected to the vertices that will be merged
+    for (auto& [nb, etype] : graph.get_neighbors(v1)) {
+        taken.insert(nb);
+    }
+    matches.emplace_back(v0, v1);
+}
+
+}  // namespace
+
+}  // namespace qsyn::zx
+
 /**
  * @brief Find non-interacting matchings of the spider fusion rule.
  *
@@ -21,21 +59,27 @@ std::vector<MatchType> SpiderFusionRule::find_matches(ZXGraph const& graph) cons
 
     std::unordered_set<ZXVertex*> taken;
 
-    graph.for_each_edge([&graph, &taken, &match_type_vec](EdgePair const& epair) {
-        if (epair.second != EdgeType::simple) return;
-        ZXVertex* v0 = epair.first.first;
-        ZXVertex* v1 = epair.first.second;  // to be merged to v0
+    for (auto const& proposal : propose_at_edges(graph, propose_spider_fusion)) {
+        resolve_spider_fusion(graph, proposal, taken, match_type_vec);
+    }
 
-        if (taken.contains(v0) || taken.contains(v1)) return;
+    return match_type_vec;
+}
 
-        if ((v0->get_type() == v1->get_type()) && (v0->is_x() || v0->is_z())) {
-            taken.insert(v0);
-            taken.insert(v1);
-            // NOTE: Cannot choose the vertex connected to the vertices that will be merged
-            for (auto& [nb, etype] : graph.get_neighbors(v1)) {
-                taken.insert(nb);
-            }
-            match_type_vec.emplace_back(v0, v1);
+/**
+ * @brief Find non-interacting matchings of the spider fusion rule on the edges incident to the candidates.
+ *
+ * @param graph The graph to find matches.
+ * @param candidates The vertices to look at.
+ */
+std::vector<MatchType> SpiderFusionRule::find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const {
+    std::vector<MatchType> match_type_vec;
+
+    std::unordered_set<ZXVertex*> taken;
+
+    graph.for_each_incident_edge(candidates, [&graph, &taken, &match_type_vec](EdgePair const& epair) {
+        if (auto const proposal = propose_spider_fusion(epair)) {
+            resolve_spider_fusion(graph, *proposal, taken, match_type_vec);
         }
     });
 
@@ -24,6 +24,8 @@ std::vector<MatchType> StateCopyRule::find_matches(ZXGraph const& graph) const {
     std::vector<MatchType> matches;
 
     std::unordered_set<ZXVertex*> taken;
+    // a vertex may neighbor several of the pi neighbors, but no more than its degree
+    _arena->reset(2 * graph.get_num_edges());
 
     for (auto const& v : graph.get_vertices()) {
         if (taken.contains(v)) continue;
@@ -46,13 +48,13 @@ std::vector<MatchType> StateCopyRule::find_matches(ZXGraph const& graph) const {
             taken.emplace(v);
             continue;
         }
-        std::vector<ZXVertex*> apply_neighbors;
+        auto const list_begin = _arena->size();
         for (auto const& [nebOfPiNeighbor, _] : graph.get_neighbors(pi_neighbor)) {
             if (nebOfPiNeighbor != v)
-                apply_neighbors.emplace_back(nebOfPiNeighbor);
+                _arena->push_back(nebOfPiNeighbor);
             taken.emplace(nebOfPiNeighbor);
         }
-        matches.emplace_back(make_tuple(v, pi_neighbor, apply_neighbors));
+        matches.emplace_back(v, pi_neighbor, _arena->list_from(list_begin));
     }
 
     return matches;
@@ -7,6 +7,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "zx/zxgraph.hpp"
@@ -20,6 +28,64 @@ struct ZXOperation {
     std::vector<ZXVertex*> vertices_to_remove;
 };
 
+/**
+ * @brief Flat storage of the vertex lists in the matches of a rule, so that finding a match
+ *        allocates nothing once the arena has grown to the size of an iteration. The arena is
+ *        owned by the caller, e.g., the Simplifier, and lent to the rule on construction. A rule
+ *        resets its arena whenever it looks for matches, which invalidates the lists of the
+ *        previous ones, so the rules sharing an arena must not look for matches at once.
+ *
+ */
+class MatchArena {
+public:
+    // A list in the arena, kept as an offset and a length and resolved against the arena on
+    // access, so that it stays valid when the arena grows
+    class List : public std::ranges::view_interface<List> {
+    public:
+        List() = default;
+        List(MatchArena const& arena, size_t offset, size_t length) : _arena{&arena}, _offset{offset}, _length{length} {}
+
+        ZXVertex* const* begin() const { return _arena == nullptr ? nullptr : _arena->_vertices.data() + _offset; }
+        ZXVertex* const* end() const { return begin() + _length; }
+        size_t size() const { return _length; }
+
+        operator std::span<ZXVertex* const>() const { return {begin(), _length}; }
+
+    private:
+        MatchArena const* _arena = nullptr;
+        size_t _offset           = 0;
+        size_t _length           = 0;
+    };
+
+    // clear the arena, keeping room for `capacity` vertices
+    void reset(size_t capacity) {
+        _vertices.clear();
+        _reserve(capacity);
+    }
+
+    size_t size() const { return _vertices.size(); }
+    void push_back(ZXVertex* v) {
+        if (_vertices.size() == _vertices.capacity()) _reserve(std::max<size_t>(1, 2 * _vertices.size()));
+        _vertices.push_back(v);
+    }
+    // the vertices pushed since the arena had `begin` vertices
+    List list_from(size_t begin) const { return {*this, begin, _vertices.size() - begin}; }
+
+    // the number of times the storage has been allocated, which stays constant once the arena
+    // is large enough for the iterations of the rules using it
+    size_t get_num_allocations() const { return _num_allocations; }
+
+private:
+    std::vector<ZXVertex*> _vertices;
+    size_t _num_allocations = 0;
+
+    void _reserve(size_t capacity) {
+        if (capacity <= _vertices.capacity()) return;
+        _vertices.reserve(capacity);
+        ++_num_allocations;
+    }
+};
+
 class ZXRuleBase {
 public:
     ZXRuleBase(std::string const& n) : _name(n) {}
@@ -32,11 +98,7 @@ protected:
         // TODO: add vertices is not implemented yet
         assert(op.vertices_to_add.empty());
 
-        for (auto& edge : op.edges_to_add) {
-            auto const [v0, v1]      = std::get<0>(edge);
-            EdgeType const edge_type = std::get<1>(edge);
-            graph.add_edge(v0, v1, edge_type);
-        }
+        graph.add_edges(op.edges_to_add);
         graph.remove_edges(op.edges_to_remove);
         graph.remove_vertices(op.vertices_to_remove);
 
@@ -44,6 +106,8 @@ protected:
     }
 };
 
+// The concrete rules are final, so that `Simplifier::simplify`, which is instantiated for each
+// rule, calls them directly instead of through the vtable
 template <typename T>
 class ZXRuleTemplate : public ZXRuleBase {
 public:
@@ -57,6 +121,105 @@ public:
     virtual std::vector<ZXVertex*> flatten_vertices(MatchType match) const          = 0;
 };
 
+// Rules that can look for matches around some candidate vertices only. The matches found
+// are those involving at least one candidate, see `Simplifier::simplify`
+template <typename Rule>
+concept incremental_rule = requires(Rule const& rule, ZXGraph const& graph, std::span<ZXVertex* const> candidates) {
+    { rule.find_matches_around(graph, candidates) } -> std::same_as<std::vector<typename Rule::MatchType>>;
+};
+
+/**
+ * @brief Check if any vertex in the match satisfies `pred`, without flattening the match into a
+ *        vector as `flatten_vertices` does. Matches are vertices, or ranges and tuples of them;
+ *        the other members, e.g., phases and edge types, are skipped.
+ *
+ * @param match
+ * @param pred
+ */
+template <typename T, typename F>
+bool any_match_vertex(T const& match, F const& pred) {
+    if constexpr (std::is_same_v<T, ZXVertex*>) {
+        return pred(match);
+    } else if constexpr (std::ranges::range<T>) {
+        return std::ranges::any_of(match, [&pred](auto const& member) { return any_match_vertex(member, pred); });
+    } else if constexpr (requires { std::tuple_size<T>::value; }) {
+        return std::apply([&pred](auto const&... members) { return (any_match_vertex(members, pred) || ...); }, match);
+    } else {
+        return false;
+    }
+}
+
+// Below this many vertices, the proposals are made on a single thread
+constexpr size_t parallel_matching_threshold = 2048;
+
+/**
+ * @brief Make the proposals of a greedy matching scan at every vertex of the graph, sharding the
+ *        vertices across threads. `propose` must only read the graph, and return an
+ *        std::optional of what the scan would do at the vertex if no vertex were taken yet.
+ *        The proposals are returned in the order of `get_vertices()`; the rule then resolves
+ *        the conflicts between them by going through them in this order and skipping those
+ *        involving a taken vertex, so the matches are the same regardless of the number of threads.
+ *
+ * @param graph
+ * @param propose
+ * @return the proposals
+ */
+template <typename F>
+auto propose_at_vertices(ZXGraph const& graph, F propose) {
+    using Proposal    = typename std::invoke_result_t<F, ZXVertex*>::value_type;
+    auto const& slots = graph.get_vertex_attributes().vertices;
+    std::vector<std::optional<Proposal>> proposed(slots.size());
+
+#pragma omp parallel for schedule(static) if (slots.size() >= parallel_matching_threshold)
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i] != nullptr) proposed[i] = propose(slots[i]);
+    }
+
+    std::vector<Proposal> proposals;
+    for (auto const& proposal : proposed) {
+        if (proposal.has_value()) proposals.emplace_back(*proposal);
+    }
+    return proposals;
+}
+
+/**
+ * @brief Make the proposals of a greedy matching scan at every edge of the graph, sharding the
+ *        edges across threads by their first vertex. The proposals are returned in the order
+ *        of `for_each_edge`. See `propose_at_vertices`.
+ *
+ * @param graph
+ * @param propose
+ * @return the proposals
+ */
+template <typename F>
+auto propose_at_edges(ZXGraph const& graph, F propose) {
+    using Proposal    = typename std::invoke_result_t<F, EdgePair const&>::value_type;
+    auto const& slots = graph.get_vertex_attributes().vertices;
+    std::vector<std::vector<Proposal>> proposed(slots.size());
+
+    // the degrees vary a lot, hence the dynamic schedule
+#pragma omp parallel for schedule(dynamic, 64) if (slots.size() >= parallel_matching_threshold)
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i] == nullptr) continue;
+        for (auto const& [nb, etype] : graph.get_neighbors(slots[i])) {
+            if (nb->get_id() <= slots[i]->get_id()) continue;
+            if (auto proposal = propose(make_edge_pair(slots[i], nb, etype))) {
+                proposed[i].emplace_back(*std::move(proposal));
+            }
+        }
+    }
+
+    std::vector<Proposal> proposals;
+    for (auto const& vertex_proposals : proposed) {
+        proposals.insert(proposals.end(), vertex_proposals.begin(), vertex_proposals.end());
+    }
+    return proposals;
+}
+
+// From this many vertices on, the neighborhoods of pivoting and local complementation are
+// complemented with `ZXGraph::complement_hadamard_edges` rather than edge by edge
+constexpr size_t dense_neighborhood_threshold = 64;
+
 // H Box related rules have simliar interface but is used differentlu in simplifier
 template <typename T>
 class HZXRuleTemplate : public ZXRuleBase {
@@ -71,7 +234,7 @@ public:
     virtual std::vector<ZXVertex*> flatten_vertices(MatchType match) const          = 0;
 };
 
-class BialgebraRule : public ZXRuleTemplate<EdgePair> {
+class BialgebraRule final : public ZXRuleTemplate<EdgePair> {
 public:
     BialgebraRule() : ZXRuleTemplate("Bialgebra Rule") {}
 
@@ -83,21 +246,28 @@ public:
     }
 };
 
-class StateCopyRule : public ZXRuleTemplate<std::tuple<ZXVertex*, ZXVertex*, std::vector<ZXVertex*>>> {
+class StateCopyRule final : public ZXRuleTemplate<std::tuple<ZXVertex*, ZXVertex*, MatchArena::List>> {
 public:
-    StateCopyRule() : ZXRuleTemplate("State Copy Rule") {}
+    // keeps the neighbors in the matches in `arena`
+    explicit StateCopyRule(MatchArena& arena) : ZXRuleTemplate("State Copy Rule"), _arena{&arena} {}
+
+    MatchArena const& get_match_arena() const { return *_arena; }
 
     std::vector<MatchType> find_matches(ZXGraph const& graph) const override;
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
     std::vector<ZXVertex*> flatten_vertices(MatchType match) const override {
-        auto [v0, v1, vertices] = match;
+        auto [v0, v1, neighbors] = match;
+        std::vector<ZXVertex*> vertices{neighbors.begin(), neighbors.end()};
         vertices.push_back(v0);
         vertices.push_back(v1);
         return vertices;
     }
+
+private:
+    MatchArena* _arena;
 };
 
-class HadamardFusionRule : public ZXRuleTemplate<ZXVertex*> {
+class HadamardFusionRule final : public ZXRuleTemplate<ZXVertex*> {
 public:
     HadamardFusionRule() : ZXRuleTemplate("Hadmard Fusion Rule") {}
 
@@ -106,39 +276,55 @@ public:
     std::vector<ZXVertex*> flatten_vertices(MatchType match) const override { return {match}; }
 };
 
-class IdentityRemovalRule : public ZXRuleTemplate<std::tuple<ZXVertex*, ZXVertex*, ZXVertex*, EdgeType>> {
+class IdentityRemovalRule final : public ZXRuleTemplate<std::tuple<ZXVertex*, ZXVertex*, ZXVertex*, EdgeType>> {
 public:
     IdentityRemovalRule() : ZXRuleTemplate("Identity Removal Rule") {}
 
     std::vector<MatchType> find_matches(ZXGraph const& graph) const override;
+    std::vector<MatchType> find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const;
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
     std::vector<ZXVertex*> flatten_vertices(MatchType match) const override { return {std::get<0>(match), std::get<1>(match), std::get<2>(match)}; }
 };
 
-class LocalComplementRule : public ZXRuleTemplate<std::pair<ZXVertex*, std::vector<ZXVertex*>>> {
+class LocalComplementRule final : public ZXRuleTemplate<std::pair<ZXVertex*, MatchArena::List>> {
 public:
-    LocalComplementRule() : ZXRuleTemplate("Local Complementation Rule") {}
+    // keeps the neighbors in the matches in `arena`
+    explicit LocalComplementRule(MatchArena& arena) : ZXRuleTemplate("Local Complementation Rule"), _arena{&arena} {}
+
+    MatchArena const& get_match_arena() const { return *_arena; }
 
     std::vector<MatchType> find_matches(ZXGraph const& graph) const override;
+    std::vector<MatchType> find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const;
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
     std::vector<ZXVertex*> flatten_vertices(MatchType match) const override {
-        auto [v0, vertices] = match;
+        auto [v0, neighbors] = match;
+        std::vector<ZXVertex*> vertices{neighbors.begin(), neighbors.end()};
         vertices.push_back(v0);
         return vertices;
     }
+
+private:
+    MatchArena* _arena;
 };
 
-class PhaseGadgetRule : public ZXRuleTemplate<std::tuple<Phase, std::vector<ZXVertex*>, std::vector<ZXVertex*>>> {
+class PhaseGadgetRule final : public ZXRuleTemplate<std::tuple<Phase, MatchArena::List, MatchArena::List>> {
 public:
-    PhaseGadgetRule() : ZXRuleTemplate("Phase Gadget Rule") {}
+    // keeps the axels and the leaves in the matches in `arena`
+    explicit PhaseGadgetRule(MatchArena& arena) : ZXRuleTemplate("Phase Gadget Rule"), _arena{&arena} {}
+
+    MatchArena const& get_match_arena() const { return *_arena; }
 
     std::vector<MatchType> find_matches(ZXGraph const& graph) const override;
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
     std::vector<ZXVertex*> flatten_vertices(MatchType match) const override {
-        auto [_, vertices0, vertices1] = match;
-        vertices0.insert(std::end(vertices0), std::begin(vertices1), std::end(vertices1));
-        return vertices0;
+        auto [_, axels, leaves] = match;
+        std::vector<ZXVertex*> vertices{axels.begin(), axels.end()};
+        vertices.insert(std::end(vertices), std::begin(leaves), std::end(leaves));
+        return vertices;
     }
+
+private:
+    MatchArena* _arena;
 };
 
 class PivotRuleInterface : public ZXRuleTemplate<std::pair<ZXVertex*, ZXVertex*>> {
@@ -150,15 +336,16 @@ public:
     std::vector<ZXVertex*> flatten_vertices(MatchType match) const override { return {match.first, match.second}; }
 };
 
-class PivotRule : public PivotRuleInterface {
+class PivotRule final : public PivotRuleInterface {
 public:
     PivotRule() : PivotRuleInterface("Pivot Rule") {}
 
     std::vector<MatchType> find_matches(ZXGraph const& graph) const override;
+    std::vector<MatchType> find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const;
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
 };
 
-class PivotGadgetRule : public PivotRuleInterface {
+class PivotGadgetRule final : public PivotRuleInterface {
 public:
     PivotGadgetRule() : PivotRuleInterface("Pivot Gadget Rule") {}
 
@@ -166,7 +353,7 @@ public:
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
 };
 
-class PivotBoundaryRule : public PivotRuleInterface {
+class PivotBoundaryRule final : public PivotRuleInterface {
 public:
     PivotBoundaryRule() : PivotRuleInterface("Pivot Boundary Rule") {}
 
@@ -174,16 +361,17 @@ public:
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
 };
 
-class SpiderFusionRule : public ZXRuleTemplate<std::pair<ZXVertex*, ZXVertex*>> {
+class SpiderFusionRule final : public ZXRuleTemplate<std::pair<ZXVertex*, ZXVertex*>> {
 public:
     SpiderFusionRule() : ZXRuleTemplate("Spider Fusion Rule") {}
 
     std::vector<MatchType> find_matches(ZXGraph const& graph) const override;
+    std::vector<MatchType> find_matches_around(ZXGraph const& graph, std::span<ZXVertex* const> candidates) const;
     void apply(ZXGraph& graph, std::vector<MatchType> const& matches) const override;
     std::vector<ZXVertex*> flatten_vertices(MatchType match) const override { return {match.first, match.second}; }
 };
 
-class HadamardRule : public HZXRuleTemplate<ZXVertex*> {
+class HadamardRule final : public HZXRuleTemplate<ZXVertex*> {
 public:
     HadamardRule() : HZXRuleTemplate("Hadamard Rule") {}
 
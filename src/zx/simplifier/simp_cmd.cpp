@@ -7,9 +7,18 @@
 
 #include "./simp_cmd.hpp"
 
+#include <fmt/ostream.h>
+
+#include <chrono>
 #include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
 #include <string>
+#include <vector>
 
+#include "./simplifier_pipeline.hpp"
+#include "./simplifier_portfolio.hpp"
 #include "./simplify.hpp"
 #include "argparse/arg_parser.hpp"
 #include "cli/cli.hpp"
@@ -30,6 +39,18 @@ bool valid_partition_reduce_partitions(size_t const &n_parts) {
     return false;
 };
 
+bool valid_partition_reduce_rounds(size_t const &n_rounds) {
+    if (n_rounds > 0) return true;
+    spdlog::error("The rounds parameter in partition reduce should be greater than 0");
+    return false;
+}
+
+bool valid_time_limit(std::string const &time_limit) {
+    if (parse_time_budget(time_limit).has_value()) return true;
+    spdlog::error("The time limit should be a duration such as 500ms, 30s or 2min");
+    return false;
+}
+
 Command zxgraph_optimize_cmd(zx::ZXGraphMgr &zxgraph_mgr) {
     return {"optimize",
             [](ArgumentParser &parser) {
@@ -57,12 +78,100 @@ Command zxgraph_optimize_cmd(zx::ZXGraphMgr &zxgraph_mgr) {
                 mutex.add_argument<bool>("-c", "--clifford")
                     .action(store_true)
                     .help("Runs reduction without producing phase gadgets");
+                mutex.add_argument<std::string>("--pipeline")
+                    .metavar("spec")
+                    .help(fmt::format("Runs the rules and routines in `spec`, separated by commas. Parenthesize steps into a sequence and append `*` to repeat it until no rule applies, "
+                                      "or `*n` for at most n rounds. Append `:n` to a rule to stop each of its runs after n iterations, or to partition-reduce to use n partitions, and `@500ms`, `@30s` or `@1min` to any step to bound its time. "
+                                      "E.g., \"(spider-fusion, pivot, local-complementation)*, pivot-gadget:2 @5s\". Rules and routines: {}",
+                                      fmt::join(SimplifierPipeline::get_step_names(), ", ")));
+                mutex.add_argument<std::string>("--portfolio")
+                    .metavar("spec")
+                    .nargs(NArgsOption::zero_or_more)
+                    .help("Runs each `spec`, written as in --pipeline, concurrently on its own copy of the graph and keeps the best result by --metric. "
+                          "A strategy is cancelled once a finished one has taken at most twice as long and scores no worse than its current graph. "
+                          "Defaults to \"full-reduce\" \"dynamic-reduce\" \"clifford\"");
+
+                parser.add_argument<std::string>("--metric")
+                    .default_value("t-count")
+                    .choices({"t-count", "2q-count", "density"})
+                    .help("The metric by which --portfolio keeps the best result. 2q-count is the number of 2-qubit gates in the circuit extracted from the result, "
+                          "so the strategies are not cancelled early with it");
+
+                parser.add_argument<size_t>("--partition-rounds")
+                    .metavar("n")
+                    .default_value(1)
+                    .constraint(valid_partition_reduce_rounds)
+                    .help("With --partition, partitions and merges the graph `n` times. Each round shifts the cuts away from the previous ones, so that the vertices next to them are reduced as well");
+
+                parser.add_argument<std::string>("--time-limit")
+                    .metavar("duration")
+                    .constraint(valid_time_limit)
+                    .help("Stops the routine once `duration`, e.g., 500ms, 30s or 2min, has passed. The rule iteration in progress is completed, so the graph stays valid");
+
+                parser.add_argument<size_t>("--effort-limit")
+                    .metavar("n")
+                    .help("Stops the routine once rules have been applied in `n` iterations in total. The graph stays valid");
+
+                parser.add_argument<bool>("--incremental")
+                    .action(store_true)
+                    .help("After the first iteration of a rule, looks for its matches only around the vertices changed by the previous iteration where the rule supports it. "
+                          "The graph is scanned in full before the rule stops, so the result is the same as without this option");
+
+                parser.add_argument<std::string>("--profile")
+                    .metavar("file")
+                    .default_value("")
+                    .nargs(NArgsOption::optional)
+                    .constraint(path_writable)
+                    .help("Records the time spent finding and applying the matches, the number of matches, and the vertices, edges and T-count removed in each iteration of each rule. "
+                          "The profile is written to `file`, or printed to the terminal if `file` is not specified. Cannot be used with --portfolio");
+
+                parser.add_argument<std::string>("--profile-format")
+                    .choices({"json", "csv"})
+                    .help("The format of the profile. Defaults to CSV if the extension of the --profile file is .csv, or to JSON otherwise");
+
+                parser.add_argument<bool>("--profile-without-times")
+                    .action(store_true)
+                    .help("Leaves the times out of the profile, so that the profiles of a routine on a graph are the same on every run, e.g., to compare the matches of two builds");
             },
             [&](ArgumentParser const &parser) {
                 if (!dvlab::utils::mgr_has_data(zxgraph_mgr)) return dvlab::CmdExecResult::error;
+                auto const pipeline = parser.parsed("--pipeline")
+                                          ? SimplifierPipeline::from_string(parser.get<std::string>("--pipeline"))
+                                          : std::nullopt;
+                if (parser.parsed("--pipeline") && !pipeline.has_value()) return CmdExecResult::error;
+                if (parser.parsed("--portfolio") && parser.parsed("--profile")) {
+                    spdlog::error("--profile cannot be used with --portfolio!!");
+                    return CmdExecResult::error;
+                }
+
+                std::optional<SimplifierPortfolio> portfolio;
+                if (parser.parsed("--portfolio")) {
+                    auto specs = parser.get<std::vector<std::string>>("--portfolio");
+                    if (specs.empty()) specs = {"full-reduce", "dynamic-reduce", "clifford"};
+                    std::vector<SimplifierPipeline> strategies;
+                    for (auto const &spec : specs) {
+                        auto strategy = SimplifierPipeline::from_string(spec);
+                        if (!strategy.has_value()) return CmdExecResult::error;
+                        strategies.emplace_back(std::move(*strategy));
+                    }
+                    portfolio.emplace(std::move(strategies), *str_to_portfolio_metric(parser.get<std::string>("--metric")));
+                }
+
+                auto const start_time = std::chrono::steady_clock::now();
                 zx::Simplifier s(zxgraph_mgr.get());
                 std::string procedure_str = "";
 
+                SimplifierProfile profile;
+                if (parser.parsed("--profile")) s.set_profile(&profile);
+                if (parser.parsed("--time-limit")) s.set_deadline(start_time + *parse_time_budget(parser.get<std::string>("--time-limit")));
+                if (parser.parsed("--effort-limit")) s.set_effort_limit(parser.get<size_t>("--effort-limit"));
+                s.set_incremental_matching(parser.parsed("--incremental"));
+
+                auto const num_vertices_before = zxgraph_mgr.get()->get_num_vertices();
+                auto const num_edges_before    = zxgraph_mgr.get()->get_num_edges();
+                auto const t_count_before      = zxgraph_mgr.get()->t_count();
+                std::optional<SimplifierPortfolio::Outcome> kept_outcome;  // with --portfolio, `s` runs no rules
+
                 if (parser.parsed("--symbolic")) {
                     s.symbolic_reduce();
                     procedure_str = "SR";
@@ -70,7 +179,7 @@ Command zxgraph_optimize_cmd(zx::ZXGraphMgr &zxgraph_mgr) {
                     s.dynamic_reduce();
                     procedure_str = "DR";
                 } else if (parser.parsed("--partition")) {
-                    s.partition_reduce(parser.get<size_t>("--partition"));
+                    s.partition_reduce(parser.get<size_t>("--partition"), parser.get<size_t>("--partition-rounds"));
                     procedure_str = "PR";
                 } else if (parser.parsed("--interior-clifford")) {
                     s.interior_clifford_simp();
@@ -78,16 +187,68 @@ Command zxgraph_optimize_cmd(zx::ZXGraphMgr &zxgraph_mgr) {
                 } else if (parser.parsed("--clifford")) {
                     s.clifford_simp();
                     procedure_str = "CR";
+                } else if (pipeline.has_value()) {
+                    spdlog::info("Pipeline: {}", pipeline->to_string());
+                    pipeline->run(s);
+                    procedure_str = "PL";
+                } else if (portfolio.has_value()) {
+                    portfolio->set_deadline(s.get_deadline());
+                    portfolio->set_effort_limit(s.get_effort_limit());
+                    portfolio->set_incremental_matching(s.is_incremental_matching());
+                    auto const best = portfolio->run(*zxgraph_mgr.get());
+                    for (size_t i = 0; i < portfolio->get_strategies().size(); ++i) {
+                        auto const &outcome = portfolio->get_outcomes()[i];
+                        spdlog::info("Strategy {}: {}", i, portfolio->get_strategies()[i].to_string());
+                        spdlog::info("    {}, {:.3f}s, {} rule iterations",
+                                     outcome.score.has_value() ? fmt::format("score {}", *outcome.score) : "no score",
+                                     std::chrono::duration<double>(outcome.time).count(), outcome.num_applied_iterations);
+                    }
+                    if (!best.has_value()) {
+                        spdlog::error("No strategy produces a result that can be scored; the graph is unchanged!!");
+                        return CmdExecResult::error;
+                    }
+                    spdlog::info("Kept the result of strategy {}", *best);
+                    kept_outcome  = portfolio->get_outcomes()[*best];
+                    procedure_str = "PF";
                 } else {
                     s.full_reduce();
                     procedure_str = "FR";
                 }
 
+                // the simplifier has logged where it stopped if it ran out of its budget
+                auto const is_out_of_budget = kept_outcome.has_value() ? kept_outcome->is_out_of_budget : s.is_out_of_budget();
+
                 if (stop_requested()) {
                     procedure_str += "[INT]";
+                } else if (is_out_of_budget) {
+                    // report how far the routine got, so that the caller can judge whether to go on
+                    spdlog::warn("Vertices: {} -> {}, edges: {} -> {}, T-count: {} -> {}",
+                                 num_vertices_before, zxgraph_mgr.get()->get_num_vertices(),
+                                 num_edges_before, zxgraph_mgr.get()->get_num_edges(),
+                                 t_count_before, zxgraph_mgr.get()->t_count());
+                    procedure_str += "[LIM]";
                 }
 
                 zxgraph_mgr.get()->add_procedure(procedure_str);
+
+                if (parser.parsed("--profile")) {
+                    auto const filepath    = parser.get<std::string>("--profile");
+                    auto const is_csv      = parser.parsed("--profile-format")
+                                                 ? parser.get<std::string>("--profile-format") == "csv"
+                                                 : std::filesystem::path{filepath}.extension() == ".csv";
+                    auto const with_times  = !parser.parsed("--profile-without-times");
+                    auto const profile_str = is_csv ? profile.to_csv(with_times) : profile.to_json(with_times);
+                    if (filepath.empty()) {
+                        fmt::print("{}", profile_str);
+                        return CmdExecResult::done;
+                    }
+                    std::ofstream file{filepath};
+                    if (!file) {
+                        spdlog::error("Cannot open file {}!!", filepath);
+                        return CmdExecResult::error;
+                    }
+                    fmt::print(file, "{}", profile_str);
+                }
                 return CmdExecResult::done;
             }};
 }
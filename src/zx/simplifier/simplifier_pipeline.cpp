@@ -0,0 +1,287 @@
+/****************************************************************************
+  PackageName  [ simplifier ]
+  Synopsis     [ Define class SimplifierPipeline member functions ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include "./simplifier_pipeline.hpp"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <tuple>
+
+#include "./simplify.hpp"
+#include "util/dvlab_string.hpp"
+#include "util/scope_guard.hpp"
+
+namespace qsyn::zx {
+
+namespace {
+
+struct NamedStep {
+    std::string_view name;
+    void (*run)(Simplifier&);
+    // if set, `:n` is passed to the routine instead of bounding the iterations of each rule
+    void (*run_with_count)(Simplifier&, size_t) = nullptr;
+};
+
+// clang-format off
+constexpr std::array named_steps = {
+    NamedStep{"bialgebra",             [](Simplifier& s) { s.bialgebra_simp(); }},
+    NamedStep{"gadget-fusion",         [](Simplifier& s) { s.phase_gadget_simp(); }},
+    NamedStep{"hadamard-fusion",       [](Simplifier& s) { s.hadamard_fusion_simp(); }},
+    NamedStep{"hadamard-rule",         [](Simplifier& s) { s.hadamard_rule_simp(); }},
+    NamedStep{"identity-removal",      [](Simplifier& s) { s.identity_removal_simp(); }},
+    NamedStep{"local-complementation", [](Simplifier& s) { s.local_complement_simp(); }},
+    NamedStep{"pivot",                 [](Simplifier& s) { s.pivot_simp(); }},
+    NamedStep{"pivot-boundary",        [](Simplifier& s) { s.pivot_boundary_simp(); }},
+    NamedStep{"pivot-gadget",          [](Simplifier& s) { s.pivot_gadget_simp(); }},
+    NamedStep{"spider-fusion",         [](Simplifier& s) { s.spider_fusion_simp(); }},
+    NamedStep{"state-copy",            [](Simplifier& s) { s.state_copy_simp(); }},
+    NamedStep{"to-z-graph",            [](Simplifier& s) { s.to_z_graph(); }},
+    NamedStep{"to-x-graph",            [](Simplifier& s) { s.to_x_graph(); }},
+    NamedStep{"interior-clifford",     [](Simplifier& s) { s.interior_clifford_simp(); }},
+    NamedStep{"clifford",              [](Simplifier& s) { s.clifford_simp(); }},
+    NamedStep{"full-reduce",           [](Simplifier& s) { s.full_reduce(); }},
+    NamedStep{"dynamic-reduce",        [](Simplifier& s) { s.dynamic_reduce(); }},
+    NamedStep{"symbolic-reduce",       [](Simplifier& s) { s.symbolic_reduce(); }},
+    NamedStep{"partition-reduce",      [](Simplifier& s) { s.partition_reduce(2); },
+                                       [](Simplifier& s, size_t n_partitions) { s.partition_reduce(n_partitions); }},
+};
+// clang-format on
+
+NamedStep const* find_named_step(std::string_view name) {
+    auto const it = std::ranges::find(named_steps, name, &NamedStep::name);
+    return it == named_steps.end() ? nullptr : &*it;
+}
+
+/**
+ * @brief Recursive descent parser of the pipeline spec. See the grammar at `SimplifierPipeline`.
+ *
+ */
+class SpecParser {
+public:
+    using Step = SimplifierPipeline::Step;
+
+    SpecParser(std::string_view spec) : _spec{spec} {}
+
+    std::optional<Step> parse() {
+        auto root = _parse_sequence();
+        if (!root.has_value()) return std::nullopt;
+        if (!_at_end()) return _error("expected `,`");
+        return root;
+    }
+
+private:
+    std::string_view _spec;
+    size_t _pos = 0;
+
+    std::nullopt_t _error(std::string_view message) const {
+        spdlog::error("Invalid pipeline at position {}: {}!!", _pos, message);
+        spdlog::error("    {}", _spec);
+        spdlog::error("    {:>{}}", "^", _pos + 1);
+        return std::nullopt;
+    }
+
+    void _skip_spaces() {
+        while (_pos < _spec.size() && std::isspace(static_cast<unsigned char>(_spec[_pos]))) ++_pos;
+    }
+
+    bool _at_end() {
+        _skip_spaces();
+        return _pos == _spec.size();
+    }
+
+    bool _consume(char c) {
+        _skip_spaces();
+        if (_pos == _spec.size() || _spec[_pos] != c) return false;
+        ++_pos;
+        return true;
+    }
+
+    std::string_view _take_while(auto pred) {
+        _skip_spaces();
+        auto const begin = _pos;
+        while (_pos < _spec.size() && pred(static_cast<unsigned char>(_spec[_pos]))) ++_pos;
+        return _spec.substr(begin, _pos - begin);
+    }
+
+    std::optional<size_t> _parse_number() {
+        auto const digits = _take_while([](unsigned char c) { return std::isdigit(c); });
+        if (digits.empty()) return std::nullopt;
+        return dvlab::str::from_string<size_t>(digits);
+    }
+
+    std::optional<Step> _parse_sequence() {
+        Step sequence;
+        do {
+            auto step = _parse_step();
+            if (!step.has_value()) return std::nullopt;
+            sequence.steps.emplace_back(std::move(*step));
+        } while (_consume(','));
+        return sequence;
+    }
+
+    std::optional<Step> _parse_step() {
+        Step step;
+        if (_consume('(')) {
+            auto sequence = _parse_sequence();
+            if (!sequence.has_value()) return std::nullopt;
+            if (!_consume(')')) return _error("expected `)`");
+            step = std::move(*sequence);
+            if (_consume('*')) {
+                step.repeat         = true;
+                step.max_iterations = _parse_number();
+                if (step.max_iterations == 0) return _error("the number of rounds should be positive");
+            }
+        } else {
+            step.name = _take_while([](unsigned char c) { return std::isalnum(c) || c == '-' || c == '_'; });
+            if (step.name.empty()) return _error("expected a rule or `(`");
+            std::ranges::replace(step.name, '_', '-');
+            if (find_named_step(step.name) == nullptr) {
+                _pos -= step.name.size();
+                return _error(fmt::format("unknown rule or routine `{}`", step.name));
+            }
+            if (_consume(':')) {
+                step.max_iterations = _parse_number();
+                if (!step.max_iterations.has_value()) return _error("expected the number of iterations");
+                if (step.max_iterations == 0) return _error("the number of iterations should be positive");
+            }
+        }
+        if (_consume('@')) {
+            auto const budget = _take_while([](unsigned char c) { return std::isalnum(c); });
+            step.time_budget  = parse_time_budget(budget);
+            if (!step.time_budget.has_value()) {
+                _pos -= budget.size();
+                return _error("expected a time budget such as `500ms`, `30s` or `1min`");
+            }
+        }
+        return step;
+    }
+};
+
+size_t run_step(SimplifierPipeline::Step const& step, Simplifier& simplifier) {
+    auto const old_deadline       = simplifier.get_deadline();
+    auto const old_max_iterations = simplifier.get_max_iterations();
+    dvlab::utils::scope_exit const restore_budgets{[&]() {
+        simplifier.set_deadline(old_deadline);
+        simplifier.set_max_iterations(old_max_iterations);
+    }};
+    if (step.time_budget.has_value()) {
+        auto const deadline = std::chrono::steady_clock::now() + *step.time_budget;
+        simplifier.set_deadline(old_deadline.has_value() ? std::min(*old_deadline, deadline) : deadline);
+    }
+
+    auto const old_num_applied = simplifier.get_num_applied_iterations();
+    auto const should_stop     = [&simplifier]() { return stop_requested() || simplifier.is_out_of_budget() || simplifier.is_cancelled(); };
+
+    if (!step.name.empty()) {
+        auto const* named_step = find_named_step(step.name);
+        if (step.max_iterations.has_value() && named_step->run_with_count != nullptr) {
+            named_step->run_with_count(simplifier, *step.max_iterations);
+        } else {
+            if (step.max_iterations.has_value()) simplifier.set_max_iterations(step.max_iterations);
+            named_step->run(simplifier);
+        }
+        return simplifier.get_num_applied_iterations() - old_num_applied;
+    }
+
+    // routines such as dynamic-reduce roll back some of the iterations they apply, so a round is
+    // also at the fixpoint if it leaves the statistics of the graph as they were
+    auto const get_statistics = [&simplifier]() {
+        auto const& graph = *simplifier.get_graph();
+        return std::tuple{graph.get_num_vertices(), graph.get_num_edges(), graph.t_count(), graph.non_clifford_count()};
+    };
+
+    for (size_t round = 0; !step.max_iterations.has_value() || round < *step.max_iterations; ++round) {
+        auto const num_applied_before_round = simplifier.get_num_applied_iterations();
+        auto const statistics_before_round  = get_statistics();
+        for (auto const& substep : step.steps) {
+            if (should_stop()) break;
+            run_step(substep, simplifier);
+        }
+        if (!step.repeat || should_stop()) break;
+        if (simplifier.get_num_applied_iterations() == num_applied_before_round || get_statistics() == statistics_before_round) break;
+    }
+    return simplifier.get_num_applied_iterations() - old_num_applied;
+}
+
+std::string step_to_string(SimplifierPipeline::Step const& step, bool is_root = false) {
+    std::string str;
+    if (!step.name.empty()) {
+        str = step.name;
+        if (step.max_iterations.has_value()) str += fmt::format(":{}", *step.max_iterations);
+    } else {
+        std::vector<std::string> substeps;
+        for (auto const& substep : step.steps) substeps.emplace_back(step_to_string(substep));
+        str = fmt::format("{}", fmt::join(substeps, ", "));
+        if (!is_root || step.repeat || step.time_budget.has_value()) str = fmt::format("({})", str);
+        if (step.repeat) str += step.max_iterations.has_value() ? fmt::format("*{}", *step.max_iterations) : "*";
+    }
+    if (step.time_budget.has_value()) str += fmt::format(" @{}ms", step.time_budget->count());
+    return str;
+}
+
+}  // namespace
+
+/**
+ * @brief Parse a time budget such as `500ms`, `30s` or `1min`
+ *
+ * @param str
+ * @return std::optional<std::chrono::milliseconds>
+ */
+std::optional<std::chrono::milliseconds> parse_time_budget(std::string_view str) {
+    auto const unit_begin = std::ranges::find_if(str, [](unsigned char c) { return !std::isdigit(c); }) - str.begin();
+    auto const amount     = dvlab::str::from_string<size_t>(str.substr(0, unit_begin));
+    if (unit_begin == 0 || !amount.has_value()) return std::nullopt;
+
+    auto const unit = str.substr(unit_begin);
+    if (unit == "ms") return std::chrono::milliseconds(*amount);
+    if (unit == "s") return std::chrono::seconds(*amount);
+    if (unit == "min") return std::chrono::minutes(*amount);
+    return std::nullopt;
+}
+
+/**
+ * @brief Parse the pipeline spec. Report the error and return std::nullopt if it is malformed.
+ *
+ * @param spec
+ * @return std::optional<SimplifierPipeline>
+ */
+std::optional<SimplifierPipeline> SimplifierPipeline::from_string(std::string_view spec) {
+    auto root = SpecParser{spec}.parse();
+    if (!root.has_value()) return std::nullopt;
+    return SimplifierPipeline{std::move(*root)};
+}
+
+/**
+ * @brief Get the names of the rules and routines that can be used as steps
+ *
+ * @return std::vector<std::string_view>
+ */
+std::vector<std::string_view> SimplifierPipeline::get_step_names() {
+    std::vector<std::string_view> names;
+    for (auto const& step : named_steps) names.emplace_back(step.name);
+    return names;
+}
+
+/**
+ * @brief Run the pipeline. The budgets of the simplifier also bound the whole pipeline.
+ *
+ * @param simplifier
+ * @return the number of iterations in which a rule is applied
+ */
+size_t SimplifierPipeline::run(Simplifier& simplifier) const {
+    return run_step(_root, simplifier);
+}
+
+std::string SimplifierPipeline::to_string() const {
+    return step_to_string(_root, true);
+}
+
+}  // namespace qsyn::zx
@@ -0,0 +1,62 @@
+/****************************************************************************
+  PackageName  [ simplifier ]
+  Synopsis     [ Define class SimplifierPipeline structure ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qsyn::zx {
+
+class Simplifier;
+
+/**
+ * @brief A composition of the simplification rules and routines, described by a spec such as
+ *
+ *            spider-fusion, to-z-graph, (identity-removal, spider-fusion, pivot, local-complementation)*,
+ *            (clifford, gadget-fusion, interior-clifford, pivot-gadget:2)*3 @10s
+ *
+ *        The steps of a sequence are separated by commas. A step is either
+ *          - a rule or routine, see `get_step_names`, optionally followed by `:n` to stop each run of
+ *            a rule in it after n iterations instead of at the fixpoint; for `partition-reduce`,
+ *            `:n` is the number of partitions instead, which is 2 by default, or
+ *          - a parenthesized sequence, optionally followed by `*` to repeat it until a round of it applies
+ *            no rule or leaves the vertex, edge and T-counts unchanged, or `*n` to do so for at most n rounds.
+ *        Any step can be followed by a time budget such as `@500ms`, `@30s` or `@1min`. When it runs out,
+ *        the step stops after the iteration in progress and the pipeline goes on with the next step.
+ *
+ */
+class SimplifierPipeline {
+public:
+    struct Step {
+        std::string name;         // the rule or routine; empty for a sequence
+        std::vector<Step> steps;  // the steps of a sequence
+        bool repeat = false;      // whether to repeat the sequence until a round changes nothing
+        // the iterations of each run of a rule, the partitions of `partition-reduce`, or the rounds of a repeated sequence
+        std::optional<size_t> max_iterations;
+        std::optional<std::chrono::milliseconds> time_budget;
+    };
+
+    SimplifierPipeline(Step root) : _root{std::move(root)} {}
+
+    static std::optional<SimplifierPipeline> from_string(std::string_view spec);
+    static std::vector<std::string_view> get_step_names();
+
+    size_t run(Simplifier& simplifier) const;
+    std::string to_string() const;
+
+private:
+    Step _root;
+};
+
+std::optional<std::chrono::milliseconds> parse_time_budget(std::string_view str);
+
+}  // namespace qsyn::zx
@@ -0,0 +1,128 @@
+/****************************************************************************
+  PackageName  [ simplifier ]
+  Synopsis     [ Define class SimplifierPortfolio member functions ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include "./simplifier_portfolio.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "./simplify.hpp"
+#include "extractor/extract.hpp"
+#include "qcir/qcir.hpp"
+#include "util/util.hpp"
+#include "zx/zxgraph.hpp"
+
+namespace qsyn::zx {
+
+std::optional<PortfolioMetric> str_to_portfolio_metric(std::string_view str) {
+    if (str == "t-count") return PortfolioMetric::t_count;
+    if (str == "2q-count") return PortfolioMetric::two_qubit_count;
+    if (str == "density") return PortfolioMetric::density;
+    return std::nullopt;
+}
+
+/**
+ * @brief Run the strategies and replace the graph with the best result. The graph is left
+ *        unchanged if no strategy produces a result that can be scored.
+ *
+ * @param graph
+ * @return the index of the winning strategy
+ */
+std::optional<size_t> SimplifierPortfolio::run(ZXGraph& graph) {
+    using std::chrono::steady_clock;
+
+    auto const n_strategies = _strategies.size();
+    auto const start        = steady_clock::now();
+
+    std::vector<ZXGraph> results(n_strategies);
+    _outcomes.assign(n_strategies, Outcome{});
+
+    std::mutex mutex;
+    std::vector<std::pair<double, Duration>> finished;  // the score and the time of each finished strategy
+
+    auto const is_dominated = [&](ZXGraph const& result) {
+        if (_metric == PortfolioMetric::two_qubit_count) return false;
+        auto const elapsed = steady_clock::now() - start;
+        auto const score   = *_score(result);
+        std::lock_guard const lock{mutex};
+        return std::ranges::any_of(finished, [&](auto const& other) {
+            return other.first <= score && other.second * _patience <= elapsed;
+        });
+    };
+
+    // the rules run single-threaded inside the strategies, as nested parallelism is off by default
+#pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(n_strategies))
+    for (size_t i = 0; i < n_strategies; ++i) {
+        results[i] = graph;
+
+        Simplifier simplifier{&results[i]};
+        simplifier.set_deadline(_deadline);
+        simplifier.set_effort_limit(_effort_limit);
+        simplifier.set_incremental_matching(_incremental_matching);
+        bool is_cancelled = false;
+        simplifier.set_cancellation([&, &result = results[i]]() {
+            is_cancelled = is_cancelled || is_dominated(result);
+            return is_cancelled;
+        });
+
+        _strategies[i].run(simplifier);
+
+        auto& outcome                  = _outcomes[i];
+        outcome.time                   = steady_clock::now() - start;
+        outcome.num_applied_iterations = simplifier.get_num_applied_iterations();
+        outcome.is_out_of_budget       = simplifier.is_out_of_budget();
+        outcome.is_past_deadline       = simplifier.is_past_deadline();
+        if (is_cancelled) {
+            spdlog::info("Strategy {} is cancelled as it is dominated", i);
+            continue;
+        }
+        outcome.score = _score(results[i]);
+        if (!outcome.score.has_value()) continue;
+
+        std::lock_guard const lock{mutex};
+        finished.emplace_back(*outcome.score, outcome.time);
+    }
+
+    std::optional<size_t> best;
+    for (size_t i = 0; i < n_strategies; ++i) {
+        if (!_outcomes[i].score.has_value()) continue;
+        if (!best.has_value() || *_outcomes[i].score < *_outcomes[*best].score) best = i;
+    }
+    if (best.has_value()) graph.swap(results[*best]);
+    return best;
+}
+
+/**
+ * @brief Score the graph by the metric. Lower is better.
+ *
+ * @param graph
+ * @return std::nullopt if the graph cannot be extracted for the 2-qubit count
+ */
+std::optional<double> SimplifierPortfolio::_score(ZXGraph const& graph) const {
+    switch (_metric) {
+        case PortfolioMetric::t_count:
+            return static_cast<double>(graph.t_count());
+        case PortfolioMetric::density:
+            return graph.density();
+        case PortfolioMetric::two_qubit_count: {
+            if (!graph.is_graph_like()) return std::nullopt;
+            // extraction consumes the graph
+            ZXGraph copied_graph = graph;
+            extractor::Extractor extractor(&copied_graph, nullptr, std::nullopt);
+            auto const circuit = std::unique_ptr<qcir::QCir>{extractor.get_logical()};
+            if (extractor.extract() == nullptr) return std::nullopt;
+            return static_cast<double>(circuit->get_gate_statistics().twoqubit);
+        }
+    }
+    DVLAB_UNREACHABLE("Unknown portfolio metric");
+}
+
+}  // namespace qsyn::zx
@@ -0,0 +1,78 @@
+/****************************************************************************
+  PackageName  [ simplifier ]
+  Synopsis     [ Define class SimplifierPortfolio structure ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./simplifier_pipeline.hpp"
+
+namespace qsyn::zx {
+
+class ZXGraph;
+
+enum class PortfolioMetric {
+    t_count,
+    two_qubit_count,  // the number of 2-qubit gates in the extracted circuit
+    density,
+};
+
+std::optional<PortfolioMetric> str_to_portfolio_metric(std::string_view str);
+
+/**
+ * @brief Runs several strategies concurrently, each on its own copy of the graph, and keeps the
+ *        result that is the best by the metric. Lower is better for all metrics.
+ *
+ *        A strategy still running is cancelled once it is dominated, i.e., a finished strategy has
+ *        taken no more than `patience` times as long and scores no worse than its current graph.
+ *        Scoring by the 2-qubit count needs an extraction, so strategies are not cancelled early then.
+ *
+ */
+class SimplifierPortfolio {
+public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    struct Outcome {
+        std::optional<double> score;  // std::nullopt if cancelled or failed to extract
+        Duration time{};
+        size_t num_applied_iterations = 0;
+        bool is_out_of_budget         = false;  // stopped at the deadline or the effort limit
+        bool is_past_deadline         = false;
+    };
+
+    SimplifierPortfolio(std::vector<SimplifierPipeline> strategies, PortfolioMetric metric)
+        : _strategies{std::move(strategies)}, _metric{metric} {}
+
+    void set_patience(double patience) { _patience = patience; }
+    // the budgets and the options given to the simplifier of each strategy
+    void set_deadline(std::optional<std::chrono::steady_clock::time_point> deadline) { _deadline = deadline; }
+    void set_effort_limit(std::optional<size_t> effort_limit) { _effort_limit = effort_limit; }
+    void set_incremental_matching(bool incremental) { _incremental_matching = incremental; }
+
+    std::optional<size_t> run(ZXGraph& graph);
+
+    std::vector<SimplifierPipeline> const& get_strategies() const { return _strategies; }
+    std::vector<Outcome> const& get_outcomes() const { return _outcomes; }
+
+private:
+    std::vector<SimplifierPipeline> _strategies;
+    PortfolioMetric _metric;
+    double _patience = 2.0;
+    std::optional<std::chrono::steady_clock::time_point> _deadline;
+    std::optional<size_t> _effort_limit;
+    bool _incremental_matching = false;
+    std::vector<Outcome> _outcomes;
+
+    std::optional<double> _score(ZXGraph const& graph) const;
+};
+
+}  // namespace qsyn::zx
@@ -0,0 +1,188 @@
+/****************************************************************************
+  PackageName  [ simplifier ]
+  Synopsis     [ Define class SimplifierProfile member functions ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include "./simplifier_profile.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "tl/enumerate.hpp"
+#include "zx/zxgraph.hpp"
+
+namespace qsyn::zx {
+
+namespace {
+
+double to_milliseconds(SimplifierProfile::Duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+std::string format_json_times(SimplifierProfile::Duration find_matches_time, SimplifierProfile::Duration apply_time) {
+    return fmt::format("\"find_matches_ms\": {:.3f}, \"apply_ms\": {:.3f}, ", to_milliseconds(find_matches_time), to_milliseconds(apply_time));
+}
+
+struct RuleSummary {
+    std::string rule_name;
+    size_t num_runs       = 0;
+    size_t num_iterations = 0;
+    size_t num_matches    = 0;
+    SimplifierProfile::Duration find_matches_time{};
+    SimplifierProfile::Duration apply_time{};
+    long long num_vertices_removed = 0;
+    long long num_edges_removed    = 0;
+    long long t_count_reduction    = 0;
+};
+
+/**
+ * @brief Sum up the records of each rule, in the order in which the rules are first run
+ *
+ * @param records
+ * @return std::vector<RuleSummary>
+ */
+std::vector<RuleSummary> summarize(std::vector<SimplifierProfile::Record> const& records) {
+    std::vector<RuleSummary> summaries;
+    std::vector<bool> is_counted_run;
+    for (auto const& record : records) {
+        auto it = std::ranges::find(summaries, record.rule_name, &RuleSummary::rule_name);
+        if (it == summaries.end()) {
+            summaries.push_back({.rule_name = record.rule_name});
+            it = std::prev(summaries.end());
+        }
+        if (record.run >= is_counted_run.size()) is_counted_run.resize(record.run + 1, false);
+        if (!is_counted_run[record.run]) {
+            is_counted_run[record.run] = true;
+            it->num_runs++;
+        }
+        it->num_iterations++;
+        it->num_matches += record.num_matches;
+        it->find_matches_time += record.find_matches_time;
+        it->apply_time += record.apply_time;
+        it->num_vertices_removed += record.num_vertices_removed;
+        it->num_edges_removed += record.num_edges_removed;
+        it->t_count_reduction += record.t_count_reduction;
+    }
+    return summaries;
+}
+
+}  // namespace
+
+RuleRunProfiler::RuleRunProfiler(SimplifierProfile* profile, ZXGraph const& graph, std::string_view rule_name)
+    : _profile{profile}, _graph{graph}, _rule_name{rule_name}, _run{profile ? profile->start_run() : 0} {}
+
+/**
+ * @brief Start timing the search for matches and take the counts to compare with at the end
+ *
+ */
+void RuleRunProfiler::start_iteration() {
+    if (_profile == nullptr) return;
+    _num_vertices_before = static_cast<long long>(_graph.get_num_vertices());
+    _num_edges_before    = static_cast<long long>(_graph.get_num_edges());
+    _t_count_before      = static_cast<long long>(_graph.t_count());
+    _iteration_start     = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Stop timing the search for matches and start timing the application
+ *
+ * @param num_matches
+ */
+void RuleRunProfiler::finish_finding_matches(size_t num_matches) {
+    if (_profile == nullptr) return;
+    _apply_start = std::chrono::steady_clock::now();
+    _num_matches = num_matches;
+}
+
+/**
+ * @brief Stop timing the application and record the iteration
+ *
+ */
+void RuleRunProfiler::finish_iteration() {
+    if (_profile == nullptr) return;
+    auto const end = std::chrono::steady_clock::now();
+    _profile->add_record({
+        .rule_name            = _rule_name,
+        .run                  = _run,
+        .iteration            = ++_num_iterations,
+        .find_matches_time    = _apply_start - _iteration_start,
+        .apply_time           = end - _apply_start,
+        .num_matches          = _num_matches,
+        .num_vertices_removed = _num_vertices_before - static_cast<long long>(_graph.get_num_vertices()),
+        .num_edges_removed    = _num_edges_before - static_cast<long long>(_graph.get_num_edges()),
+        .t_count_reduction    = _t_count_before - static_cast<long long>(_graph.t_count()),
+    });
+}
+
+/**
+ * @brief Append the records of `other`, e.g., of a simplifier run on another thread, as if its
+ *        rule runs followed the ones recorded so far
+ *
+ * @param other
+ */
+void SimplifierProfile::merge(SimplifierProfile const& other) {
+    for (auto record : other._records) {
+        record.run += _num_runs;
+        _records.emplace_back(std::move(record));
+    }
+    _num_runs += other._num_runs;
+}
+
+/**
+ * @brief Format the profile as a JSON object, with a summary for each rule under "rules" and
+ *        every iteration under "iterations". Times are in milliseconds.
+ *
+ * @param with_times whether to include the times
+ * @return std::string
+ */
+std::string SimplifierProfile::to_json(bool with_times) const {
+    std::string json = "{\n  \"rules\": [";
+    auto out         = std::back_inserter(json);
+    for (auto const& [i, summary] : tl::views::enumerate(summarize(_records))) {
+        fmt::format_to(out,
+                       "{}\n    {{\"rule\": \"{}\", \"runs\": {}, \"iterations\": {}, \"matches\": {}, {}"
+                       "\"vertices_removed\": {}, \"edges_removed\": {}, \"t_count_reduction\": {}}}",
+                       i == 0 ? "" : ",",
+                       summary.rule_name, summary.num_runs, summary.num_iterations, summary.num_matches,
+                       with_times ? format_json_times(summary.find_matches_time, summary.apply_time) : "",
+                       summary.num_vertices_removed, summary.num_edges_removed, summary.t_count_reduction);
+    }
+    json += "\n  ],\n  \"iterations\": [";
+    for (auto const& [i, record] : tl::views::enumerate(_records)) {
+        fmt::format_to(out,
+                       "{}\n    {{\"rule\": \"{}\", \"run\": {}, \"iteration\": {}, \"matches\": {}, {}"
+                       "\"vertices_removed\": {}, \"edges_removed\": {}, \"t_count_reduction\": {}}}",
+                       i == 0 ? "" : ",",
+                       record.rule_name, record.run, record.iteration, record.num_matches,
+                       with_times ? format_json_times(record.find_matches_time, record.apply_time) : "",
+                       record.num_vertices_removed, record.num_edges_removed, record.t_count_reduction);
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+/**
+ * @brief Format the profile as CSV, one row per iteration. Times are in milliseconds.
+ *
+ * @param with_times whether to include the times
+ * @return std::string
+ */
+std::string SimplifierProfile::to_csv(bool with_times) const {
+    std::string csv = with_times
+                          ? "rule,run,iteration,matches,find_matches_ms,apply_ms,vertices_removed,edges_removed,t_count_reduction\n"
+                          : "rule,run,iteration,matches,vertices_removed,edges_removed,t_count_reduction\n";
+    auto out        = std::back_inserter(csv);
+    for (auto const& record : _records) {
+        fmt::format_to(out, "{},{},{},{},", record.rule_name, record.run, record.iteration, record.num_matches);
+        if (with_times) fmt::format_to(out, "{:.3f},{:.3f},", to_milliseconds(record.find_matches_time), to_milliseconds(record.apply_time));
+        fmt::format_to(out, "{},{},{}\n", record.num_vertices_removed, record.num_edges_removed, record.t_count_reduction);
+    }
+    return csv;
+}
+
+}  // namespace qsyn::zx
@@ -0,0 +1,85 @@
+/****************************************************************************
+  PackageName  [ simplifier ]
+  Synopsis     [ Define class SimplifierProfile structure ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qsyn::zx {
+
+class ZXGraph;
+
+/**
+ * @brief Records the cost and the effect of each iteration of the rules run by a Simplifier,
+ *        so that the rules dominating the runtime can be told apart.
+ *
+ */
+class SimplifierProfile {
+public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    struct Record {
+        std::string rule_name;
+        size_t run;        // the number of the rule runs before this one, counting all rules
+        size_t iteration;  // 1-based, within the run
+        Duration find_matches_time;
+        Duration apply_time;
+        size_t num_matches;
+        // the following are negative if the rule increases the count
+        long long num_vertices_removed;
+        long long num_edges_removed;
+        long long t_count_reduction;
+    };
+
+    size_t start_run() { return _num_runs++; }
+    void add_record(Record record) { _records.emplace_back(std::move(record)); }
+    void merge(SimplifierProfile const& other);
+
+    std::vector<Record> const& get_records() const { return _records; }
+
+    // leave the times out if not `with_times`, so that the profiles of a routine are the same
+    // on every run
+    std::string to_json(bool with_times = true) const;
+    std::string to_csv(bool with_times = true) const;
+
+private:
+    size_t _num_runs = 0;
+    std::vector<Record> _records;
+};
+
+/**
+ * @brief Profiles the iterations of one run of a rule. Does nothing if there is no profile.
+ *
+ */
+class RuleRunProfiler {
+public:
+    RuleRunProfiler(SimplifierProfile* profile, ZXGraph const& graph, std::string_view rule_name);
+
+    void start_iteration();
+    void finish_finding_matches(size_t num_matches);
+    void finish_iteration();
+
+private:
+    SimplifierProfile* _profile;
+    ZXGraph const& _graph;
+    std::string _rule_name;
+    size_t _run            = 0;
+    size_t _num_iterations = 0;
+
+    std::chrono::steady_clock::time_point _iteration_start;
+    std::chrono::steady_clock::time_point _apply_start;
+    size_t _num_matches            = 0;
+    long long _num_vertices_before = 0;
+    long long _num_edges_before    = 0;
+    long long _t_count_before      = 0;
+};
+
+}  // namespace qsyn::zx
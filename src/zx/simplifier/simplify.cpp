@@ -7,7 +7,14 @@
 
 #include "./simplify.hpp"
 
+#include <algorithm>
 #include <cstddef>
+#include <limits>
+#include <ranges>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "util/util.hpp"
 #include "zx/zx_def.hpp"
@@ -23,11 +30,11 @@ size_t Simplifier::bialgebra_simp() {
 }
 
 size_t Simplifier::state_copy_simp() {
-    return simplify(StateCopyRule());
+    return simplify(StateCopyRule(get_match_arena<StateCopyRule>()));
 }
 
 size_t Simplifier::phase_gadget_simp() {
-    return simplify(PhaseGadgetRule());
+    return simplify(PhaseGadgetRule(get_match_arena<PhaseGadgetRule>()));
 }
 
 size_t Simplifier::hadamard_fusion_simp() {
@@ -43,7 +50,7 @@ size_t Simplifier::identity_removal_simp() {
 }
 
 size_t Simplifier::local_complement_simp() {
-    return simplify(LocalComplementRule());
+    return simplify(LocalComplementRule(get_match_arena<LocalComplementRule>()));
 }
 
 size_t Simplifier::pivot_simp() {
@@ -74,6 +81,19 @@ void Simplifier::to_z_graph() {
     }
 }
 
+/**
+ * @brief Turn the red nodes in the scope and next to it into green nodes, so that the
+ *        scoped rules see the same spiders around the scope as after `to_z_graph`
+ *
+ */
+void Simplifier::scoped_to_z_graph(ZXVertexList const& scope) {
+    for (auto const& v : _get_scope_neighborhood(scope)) {
+        if (v->get_type() == VertexType::x) {
+            _simp_graph->toggle_vertex(v);
+        }
+    }
+}
+
 /**
  * @brief Turn green nodes into red nodes by color-changing vertices which greedily reducing the number of Hadamard-edges.
  *
@@ -94,14 +114,15 @@ void Simplifier::to_x_graph() {
 size_t Simplifier::interior_clifford_simp() {
     this->spider_fusion_simp();
     this->to_z_graph();
-    for (size_t iterations = 0; !stop_requested(); iterations++) {
+    size_t iterations = 0;
+    for (; !_should_stop(); iterations++) {
         auto const i1 = this->identity_removal_simp();
         auto const i2 = this->spider_fusion_simp();
         auto const i3 = this->pivot_simp();
         auto const i4 = this->local_complement_simp();
-        if (i1 + i2 + i3 + i4 == 0) return iterations;
+        if (i1 + i2 + i3 + i4 == 0) break;
     }
-    DVLAB_UNREACHABLE("This line should not be reached");
+    return iterations;
 }
 
 /**
@@ -111,7 +132,7 @@ size_t Simplifier::interior_clifford_simp() {
  */
 size_t Simplifier::clifford_simp() {
     size_t iterations = 0;
-    while (true) {
+    while (!_should_stop()) {
         auto const i1 = this->interior_clifford_simp();
         iterations += i1;
         auto const i2 = this->pivot_boundary_simp();
@@ -127,7 +148,7 @@ size_t Simplifier::clifford_simp() {
 void Simplifier::full_reduce() {
     this->interior_clifford_simp();
     this->pivot_gadget_simp();
-    while (!stop_requested()) {
+    while (!_should_stop()) {
         this->clifford_simp();
         auto i1 = this->phase_gadget_simp();
         this->interior_clifford_simp();
@@ -140,17 +161,55 @@ void Simplifier::full_reduce() {
  * @brief Perform a full reduce on the graph to determine the optimal T-count automatically
  *        and then perform a dynamic reduce
  *
+ *        Instead of running full reduce on a copy and then again on the graph, the graph is
+ *        reduced once while checking the T-count wherever `dynamic_reduce(size_t)` would.
+ *        A checkpoint is kept only at the first of these points that reaches the lowest
+ *        T-count so far; the previous one is committed, so the journal never holds more
+ *        than the rewrites since the current T-minimum. Afterwards, the graph is rolled back
+ *        to that checkpoint, and the reports of the rules run before it are logged again, as
+ *        the second run used to.
+ *
  */
 void Simplifier::dynamic_reduce() {
-    // copy the graph's structure
-    ZXGraph copied_graph = *_simp_graph;
+    auto t_minimum = std::numeric_limits<size_t>::max();  // the T-count at the open checkpoint
+    size_t n_kept_reports = 0;                              // the number of reports before it
+    auto const checkpoint = [this, &t_minimum, &n_kept_reports]() {
+        auto const t_count = _simp_graph->t_count();
+        if (t_count >= t_minimum) return;
+        if (t_minimum != std::numeric_limits<size_t>::max()) {
+            _simp_graph->commit();
+        }
+        _simp_graph->checkpoint();
+        t_minimum      = t_count;
+        n_kept_reports = _recorded_reports->size();
+    };
+
+    _recorded_reports.emplace();
+
     spdlog::info("Full Reduce:");
-    // to obtain the T-optimal
-    Simplifier(&copied_graph).full_reduce();
-    auto t_optimal = copied_graph.t_count();
+    this->interior_clifford_simp();
+    this->pivot_gadget_simp();
+    checkpoint();
+    while (!_should_stop()) {
+        this->clifford_simp();
+        checkpoint();
+        auto i1 = this->phase_gadget_simp();
+        checkpoint();
+        this->interior_clifford_simp();
+        checkpoint();
+        auto i2 = this->pivot_gadget_simp();
+        checkpoint();
+        if (i1 + i2 == 0) break;
+    }
 
-    spdlog::info("Dynamic Reduce: (T-optimal: {})", t_optimal);
-    dynamic_reduce(t_optimal);
+    // none of the rewrites increases the T-count, so the final T-count is the minimum
+    spdlog::info("Dynamic Reduce: (T-optimal: {})", t_minimum);
+    _simp_graph->rollback();
+
+    auto reports = *std::exchange(_recorded_reports, std::nullopt);
+    for (auto& [rule_name, match_counts] : reports | std::views::take(n_kept_reports)) {
+        _report_simp_result(rule_name, match_counts);
+    }
 }
 
 /**
@@ -165,7 +224,7 @@ void Simplifier::dynamic_reduce(size_t optimal_t_count) {
         return;
     }
 
-    while (!stop_requested()) {
+    while (!_should_stop()) {
         this->clifford_simp();
         if (_simp_graph->t_count() == optimal_t_count) {
             break;
@@ -194,7 +253,7 @@ void Simplifier::symbolic_reduce() {
     this->interior_clifford_simp();
     this->pivot_gadget_simp();
     this->state_copy_simp();
-    while (!stop_requested()) {
+    while (!_should_stop()) {
         this->clifford_simp();
         auto i1 = this->phase_gadget_simp();
         this->interior_clifford_simp();
@@ -205,7 +264,29 @@ void Simplifier::symbolic_reduce() {
     this->to_x_graph();
 }
 
-void Simplifier::_report_simp_result(std::string_view rule_name, std::span<size_t> match_counts) const {
+/**
+ * @brief Check if the deadline has passed or the effort limit is reached. The first time it is,
+ *        log that the routine stops there, so that every routine and pipeline step stopping at a
+ *        budget reports it.
+ *
+ * @return true if out of budget
+ */
+bool Simplifier::is_out_of_budget() const {
+    auto const is_past_deadline = this->is_past_deadline();
+    if (!is_past_deadline && !is_out_of_effort()) return false;
+    if (!_has_reported_budget) {
+        _has_reported_budget = true;
+        spdlog::warn("Stopped at the {} limit after {} rule iterations; the graph may be reducible further",
+                     is_past_deadline ? "time" : "effort", _num_applied_iterations);
+    }
+    return true;
+}
+
+void Simplifier::_report_simp_result(std::string_view rule_name, std::span<size_t> match_counts) {
+    if (_recorded_reports.has_value()) {
+        _recorded_reports->emplace_back(std::string{rule_name}, std::vector<size_t>(match_counts.begin(), match_counts.end()));
+    }
+
     spdlog::log(
         match_counts.size() > 0 ? spdlog::level::info : spdlog::level::trace,
         "{:<28} {:>2} iterations, total {:>4} matches",
@@ -220,3 +301,37 @@ void Simplifier::_report_simp_result(std::string_view rule_name, std::span<size_
             i + 1, match_counts[i]);
     }
 }
+
+/**
+ * @brief Log how many times the match arena of a rule has been allocated. The count stays the
+ *        same over the iterations once the arena has grown to their size, i.e., finding the
+ *        matches allocates nothing per match.
+ *
+ * @param rule_name
+ * @param arena
+ */
+void Simplifier::_report_match_arena(std::string_view rule_name, MatchArena const& arena) const {
+    spdlog::trace("{:<28} match arena allocated {} times so far", rule_name, arena.get_num_allocations());
+}
+
+/**
+ * @brief Get the vertices of the scope that are still in the graph, followed by their neighbors.
+ *        The matches involving a vertex in the scope are around these vertices.
+ *
+ * @param scope
+ * @return std::vector<ZXVertex*>
+ */
+std::vector<ZXVertex*> Simplifier::_get_scope_neighborhood(ZXVertexList const& scope) const {
+    std::vector<ZXVertex*> neighborhood;
+    std::unordered_set<ZXVertex*> seen;
+    for (auto const& v : scope) {
+        if (_simp_graph->get_vertices().contains(v) && seen.insert(v).second) neighborhood.emplace_back(v);
+    }
+    auto const num_in_scope = neighborhood.size();
+    for (size_t i = 0; i < num_in_scope; ++i) {
+        for (auto const& [nb, _] : _simp_graph->get_neighbors(neighborhood[i])) {
+            if (seen.insert(nb).second) neighborhood.emplace_back(nb);
+        }
+    }
+    return neighborhood;
+}
@@ -7,11 +7,21 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string>
 #include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "./rules/zx_rules_template.hpp"
+#include "./simplifier_profile.hpp"
 
 extern bool stop_requested();
 
@@ -28,6 +38,12 @@ public:
     /**
      * @brief apply the rule on the zx graph
      *
+     *        With incremental matching on and if the rule supports it, only the first iteration
+     *        scans the whole graph. Later iterations look for matches around the vertices changed
+     *        by the previous one, unless most of the graph has changed. The whole graph is scanned
+     *        again to confirm that no match is left. Stops early when the iteration budget or the
+     *        deadline is reached.
+     *
      * @return number of iterations
      */
     template <typename Rule>
@@ -35,18 +51,50 @@ public:
         static_assert(std::is_base_of<ZXRuleTemplate<typename Rule::MatchType>, Rule>::value, "Rule must be a subclass of ZXRule");
 
         std::vector<size_t> match_counts;
+        RuleRunProfiler profiler(_profile, *_simp_graph, rule.get_name());
+
+        auto const incremental = incremental_rule<Rule> && _incremental_matching;
+        if (incremental) _simp_graph->start_tracking_changes();
+        bool scan_changes_only = false;
 
-        while (!stop_requested()) {
-            std::vector<typename Rule::MatchType> const matches = rule.find_matches(*_simp_graph);
+        while (!_should_stop(match_counts.size())) {
+            profiler.start_iteration();
+            std::vector<typename Rule::MatchType> matches;
+            bool scanned_whole_graph = true;
+            if constexpr (incremental_rule<Rule>) {
+                // scan the whole graph anyway if most of it has changed
+                auto const candidates = scan_changes_only
+                                            ? _simp_graph->take_changed_neighborhood(_simp_graph->get_num_vertices() / 2)
+                                            : std::nullopt;
+                scanned_whole_graph = !candidates.has_value();
+                matches             = scanned_whole_graph
+                                          ? _find_matches(rule)
+                                          : rule.find_matches_around(*_simp_graph, *candidates);
+            } else {
+                matches = _find_matches(rule);
+            }
+            profiler.finish_finding_matches(matches.size());
             if (matches.empty()) {
-                break;
+                profiler.finish_iteration();
+                if (scanned_whole_graph) break;
+                // Matches skipped in earlier iterations for overlapping others may lie away from
+                // the changes. Rescanning the whole graph before stopping keeps the fixpoint
+                // identical to that without incremental matching.
+                scan_changes_only = false;
+                continue;
             }
             match_counts.emplace_back(matches.size());
 
             rule.apply(*_simp_graph, matches);
+            profiler.finish_iteration();
+            _num_applied_iterations++;
+            scan_changes_only = incremental;
         }
 
+        if (incremental) _simp_graph->stop_tracking_changes();
+
         _report_simp_result(rule.get_name(), match_counts);
+        if constexpr (requires { rule.get_match_arena(); }) _report_match_arena(rule.get_name(), rule.get_match_arena());
 
         return match_counts.size();
     }
@@ -61,17 +109,23 @@ public:
         static_assert(std::is_base_of<HZXRuleTemplate<typename Rule::MatchType>, Rule>::value, "Rule must be a subclass of HZXRule");
 
         std::vector<size_t> match_counts;
+        RuleRunProfiler profiler(_profile, *_simp_graph, rule.get_name());
 
-        while (!stop_requested()) {
+        while (!_should_stop(match_counts.size())) {
             auto const old_vertex_count = _simp_graph->get_num_vertices();
 
-            std::vector<typename Rule::MatchType> const matches = rule.find_matches(*_simp_graph);
+            profiler.start_iteration();
+            std::vector<typename Rule::MatchType> const matches = _find_matches(rule);
+            profiler.finish_finding_matches(matches.size());
             if (matches.empty()) {
+                profiler.finish_iteration();
                 break;
             }
             match_counts.emplace_back(matches.size());
 
             rule.apply(*_simp_graph, matches);
+            profiler.finish_iteration();
+            _num_applied_iterations++;
             if (_simp_graph->get_num_vertices() >= old_vertex_count) break;
         }
 
@@ -81,7 +135,9 @@ public:
     }
 
     /**
-     * @brief apply the rule on the vertices in the scope
+     * @brief apply the rule on the vertices in the scope, i.e., only the matches involving a vertex
+     *        in the scope are applied. If the rule supports it and the scope is small, only the
+     *        scope and its neighbors are searched for matches; otherwise the whole graph is.
      *
      * @return number of iterations
      */
@@ -90,26 +146,35 @@ public:
         static_assert(std::is_base_of<ZXRuleTemplate<typename Rule::MatchType>, Rule>::value, "Rule must be a subclass of ZXRule");
 
         std::vector<size_t> match_counts;
+        RuleRunProfiler profiler(_profile, *_simp_graph, rule.get_name());
+        auto const is_in_scope = [&scope](ZXVertex* v) { return scope.contains(v); };
 
-        while (!stop_requested()) {
-            std::vector<typename Rule::MatchType> const matches = rule.find_matches(*_simp_graph);
-            std::vector<typename Rule::MatchType> scoped_matches;
-            auto is_in_scope = [&scope](ZXVertex* v) { return scope.contains(v); };
-            for (auto& match : matches) {
-                std::vector<ZXVertex*> match_vertices = rule.flatten_vertices(match);
-                if (std::ranges::any_of(match_vertices, is_in_scope)) {
-                    scoped_matches.push_back(match);
-                }
+        while (!_should_stop(match_counts.size())) {
+            profiler.start_iteration();
+            std::vector<typename Rule::MatchType> matches;
+            if constexpr (incremental_rule<Rule>) {
+                // scan the whole graph anyway if the scope covers most of it
+                matches = scope.size() < _simp_graph->get_num_vertices() / 2
+                              ? rule.find_matches_around(*_simp_graph, _get_scope_neighborhood(scope))
+                              : _find_matches(rule);
+            } else {
+                matches = _find_matches(rule);
             }
-            if (scoped_matches.empty()) {
+            std::erase_if(matches, [&is_in_scope](auto const& match) { return !any_match_vertex(match, is_in_scope); });
+            profiler.finish_finding_matches(matches.size());
+            if (matches.empty()) {
+                profiler.finish_iteration();
                 break;
             }
-            match_counts.emplace_back(scoped_matches.size());
+            match_counts.emplace_back(matches.size());
 
-            rule.apply(*_simp_graph, scoped_matches);
+            rule.apply(*_simp_graph, matches);
+            profiler.finish_iteration();
+            _num_applied_iterations++;
         }
 
         _report_simp_result(rule.get_name(), match_counts);
+        if constexpr (requires { rule.get_match_arena(); }) _report_match_arena(rule.get_name(), rule.get_match_arena());
 
         return match_counts.size();
     }
@@ -135,14 +200,88 @@ public:
     void dynamic_reduce();
     void dynamic_reduce(size_t optimal_t_count);
     void symbolic_reduce();
-    void partition_reduce(size_t n_partitions);
+    void partition_reduce(size_t n_partitions, size_t n_rounds = 1);
 
     void to_z_graph();
     void to_x_graph();
+    void scoped_to_z_graph(ZXVertexList const& scope);
+
+    ZXGraph const* get_graph() const { return _simp_graph; }
+
+    // The arena of the rules of type `Rule` whose matches hold vertex lists. It is kept across the
+    // runs of the rules and cleared whenever they look for matches, so that finding matches
+    // allocates nothing once it has grown to the size of an iteration
+    template <typename Rule>
+    MatchArena& get_match_arena() { return _match_arenas[std::type_index{typeid(Rule)}]; }
+
+    // record every iteration of the rules run from now on to `profile`, or stop recording if nullptr
+    void set_profile(SimplifierProfile* profile) { _profile = profile; }
+
+    // whether `simplify` looks for matches only around the vertices changed by the previous
+    // iteration, for the rules supporting it. Off by default; the results are the same either way
+    void set_incremental_matching(bool incremental) { _incremental_matching = incremental; }
+    bool is_incremental_matching() const { return _incremental_matching; }
+
+    // Budgets. Each run of a rule stops after `max_iterations` iterations, and all rules and
+    // routines stop after the iteration in progress once the deadline has passed or rules have
+    // been applied in `effort_limit` iterations in total. The graph is valid whenever they stop.
+    // Running out of the deadline or the effort limit is logged once until they are set anew.
+    using Deadline = std::chrono::steady_clock::time_point;
+    void set_max_iterations(std::optional<size_t> max_iterations) { _max_iterations = max_iterations; }
+    void set_deadline(std::optional<Deadline> deadline) {
+        _deadline = deadline;
+        _rearm_budget_report();
+    }
+    void set_effort_limit(std::optional<size_t> effort_limit) {
+        _effort_limit = effort_limit;
+        _rearm_budget_report();
+    }
+    std::optional<size_t> get_max_iterations() const { return _max_iterations; }
+    std::optional<Deadline> get_deadline() const { return _deadline; }
+    std::optional<size_t> get_effort_limit() const { return _effort_limit; }
+    bool is_past_deadline() const { return _deadline.has_value() && std::chrono::steady_clock::now() >= *_deadline; }
+    bool is_out_of_effort() const { return _effort_limit.has_value() && _num_applied_iterations >= *_effort_limit; }
+    bool is_out_of_budget() const;
+
+    // the number of iterations in which a rule has been applied, counting all rules
+    size_t get_num_applied_iterations() const { return _num_applied_iterations; }
+
+    // stop like at the deadline once `is_cancelled` returns true, e.g., when another thread no
+    // longer needs the result. It is called between iterations and never concurrently, though
+    // `partition_reduce` calls it from the threads reducing the subgraphs
+    void set_cancellation(std::function<bool()> is_cancelled) { _is_cancelled = std::move(is_cancelled); }
+    bool is_cancelled() const { return _is_cancelled && _is_cancelled(); }
 
 private:
-    void _report_simp_result(std::string_view rule_name, std::span<size_t> match_counts) const;
+    template <typename Rule>
+    std::vector<typename Rule::MatchType> _find_matches(Rule const& rule) {
+        // the gadget rules read the gadget index, which is only brought up to date on request
+        if constexpr (std::is_same_v<Rule, PhaseGadgetRule> || std::is_same_v<Rule, PivotGadgetRule>) _simp_graph->update_gadget_index();
+        return rule.find_matches(*_simp_graph);
+    }
+    void _report_simp_result(std::string_view rule_name, std::span<size_t> match_counts);
+    void _report_match_arena(std::string_view rule_name, MatchArena const& arena) const;
+    // a budget that is still exhausted, e.g., the deadline of a routine restored after a step
+    // running out of it, has been reported already
+    void _rearm_budget_report() {
+        if (!is_past_deadline() && !is_out_of_effort()) _has_reported_budget = false;
+    }
+    std::vector<ZXVertex*> _get_scope_neighborhood(ZXVertexList const& scope) const;
+    bool _should_stop() const { return stop_requested() || is_out_of_budget() || is_cancelled(); }
+    bool _should_stop(size_t iterations) const { return _should_stop() || (_max_iterations.has_value() && iterations >= *_max_iterations); }
+
     ZXGraph* _simp_graph;
+    SimplifierProfile* _profile = nullptr;
+    bool _incremental_matching  = false;
+    std::unordered_map<std::type_index, MatchArena> _match_arenas;
+    std::optional<size_t> _max_iterations;
+    std::optional<Deadline> _deadline;
+    std::optional<size_t> _effort_limit;
+    size_t _num_applied_iterations    = 0;
+    mutable bool _has_reported_budget = false;
+    std::function<bool()> _is_cancelled;
+    // the reports of the rules run by `dynamic_reduce`, which replays those up to its checkpoint
+    std::optional<std::vector<std::pair<std::string, std::vector<size_t>>>> _recorded_reports;
 };
 
 }  // namespace qsyn::zx
@@ -19,6 +19,7 @@
 #include "qsyn/qsyn_type.hpp"
 #include "util/ordered_hashmap.hpp"
 #include "util/ordered_hashset.hpp"
+#include "util/small_ordered_hashset.hpp"
 #include "util/phase.hpp"
 #include "util/text_format.hpp"
 
@@ -67,7 +68,8 @@ struct EdgePairHash {
                (std::hash<EdgeType>()(k.second) << 1);
     }
 };
-using Neighbors = dvlab::utils::ordered_hashset<NeighborPair, NeighborPairHash>;
+// most spiders have only a handful of neighbors, which are then stored inline in the vertex itself
+using Neighbors = dvlab::utils::small_ordered_hashset<NeighborPair, 6, NeighborPairHash>;
 
 struct ZXCutHash {
     size_t operator()(ZXCut const& cut) const {
@@ -0,0 +1,158 @@
+/****************************************************************************
+  PackageName  [ zx ]
+  Synopsis     [ Define class ZXGraph journal functions ]
+  Author       [ Design Verification Lab ]
+  Copyright    [ Copyright(c) 2023 DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cassert>
+#include <variant>
+
+#include "./zxgraph.hpp"
+
+namespace qsyn::zx {
+
+/*
+ * While a checkpoint is active, ZXGraph records the mutations that go through
+ * `add_vertex`, `remove_vertex`, the edge functions, and the setters of
+ * `ZXVertex`, so that the graph can later be rolled back in time
+ * proportional to the number of mutations. The graph is restored exactly,
+ * including the order of the vertices and the neighbors, so that anything
+ * run after the rollback behaves as if the rolled-back mutations never
+ * happened. Vertices removed under a checkpoint are kept alive until the
+ * outermost checkpoint is committed.
+ *
+ * Operations that reorganize the graph as a whole, e.g., `compose`,
+ * `tensor_product`, `adjoint`, `sort_io_by_qubit` or `relabel_vertex_ids`,
+ * are not journaled and should not be called under a checkpoint.
+ */
+
+/**
+ * @brief Start recording the mutations of the graph. Checkpoints can be nested;
+ *        each of them must be closed with either `rollback` or `commit`.
+ *
+ */
+void ZXGraph::checkpoint() {
+    if (!is_journaling()) {
+        // keep the ids in the ordered hashsets stable so that the removed vertices can be put back in place
+        _vertices.suspend_sweep();
+        _inputs.suspend_sweep();
+        _outputs.suspend_sweep();
+    }
+    _checkpoints.push_back({_journal.size(), _next_v_id});
+}
+
+/**
+ * @brief Undo all mutations since the last checkpoint and close it.
+ *
+ */
+void ZXGraph::rollback() {
+    assert(is_journaling());
+    auto const checkpoint = _checkpoints.back();
+
+    _is_rolling_back = true;
+    while (_journal.size() > checkpoint.journal_size) {
+        _undo(_journal.back());
+        _journal.pop_back();
+    }
+    _is_rolling_back = false;
+    _invalidate_traversal_cache();
+
+    _next_v_id = checkpoint.next_v_id;
+    _checkpoints.pop_back();
+    if (!is_journaling()) {
+        _vertices.resume_sweep();
+        _inputs.resume_sweep();
+        _outputs.resume_sweep();
+        _compact_attributes();
+    }
+}
+
+/**
+ * @brief Keep all mutations since the last checkpoint and close it. If there is
+ *        an enclosing checkpoint, the mutations can still be rolled back by it.
+ *
+ */
+void ZXGraph::commit() {
+    assert(is_journaling());
+    _checkpoints.pop_back();
+    if (is_journaling()) return;
+
+    for (auto& entry : _journal) {
+        if (auto const removal = std::get_if<VertexRemoval>(&entry)) {
+            _vertex_pool.destroy(removal->vertex);
+        }
+    }
+    _journal.clear();
+    _vertices.resume_sweep();
+    _inputs.resume_sweep();
+    _outputs.resume_sweep();
+    _compact_attributes();
+}
+
+/**
+ * @brief Undo a single mutation. The entries must be undone in the reverse order of recording.
+ *
+ * @param entry
+ */
+void ZXGraph::_undo(JournalEntry const& entry) {
+    if (auto const addition = std::get_if<VertexAddition>(&entry)) {
+        // all edges to the vertex have already been undone
+        auto const v = addition->vertex;
+        if (_inputs.contains(v)) {
+            _input_list.erase(v->get_qubit());
+            _inputs.erase(v);
+        }
+        if (_outputs.contains(v)) {
+            _output_list.erase(v->get_qubit());
+            _outputs.erase(v);
+        }
+        _vertices.erase(v);
+        _unindex_vertex(v);
+        _remove_from_statistics(v);
+        _clear_attributes(v->_bookkeeping.slot);
+        _vertex_pool.destroy(v);
+    } else if (auto const removal = std::get_if<VertexRemoval>(&entry)) {
+        auto const v = removal->vertex;
+        _vertices.restore(removal->vertex_id, v);
+        _index_vertex(v);
+        // the attribute arrays are not compacted under a checkpoint, so the slot is still vacant
+        _attributes.vertices[v->_bookkeeping.slot] = v;
+        if (removal->input_id.has_value()) {
+            _inputs.restore(*removal->input_id, v);
+            _input_list.emplace(v->get_qubit(), v);
+        }
+        if (removal->output_id.has_value()) {
+            _outputs.restore(*removal->output_id, v);
+            _output_list.emplace(v->get_qubit(), v);
+        }
+        _add_to_statistics(v);
+        _store_attributes(v);
+    } else if (auto const neighbor_addition = std::get_if<NeighborAddition>(&entry)) {
+        _remove_neighbor(neighbor_addition->vertex, neighbor_addition->neighbor.first, neighbor_addition->neighbor.second);
+    } else if (auto const neighbor_removal = std::get_if<NeighborRemoval>(&entry)) {
+        auto const v = neighbor_removal->vertex;
+        _remove_from_statistics(v);
+        v->_neighbors.insert_at(neighbor_removal->index, neighbor_removal->neighbor);
+        _add_to_statistics(v);
+        _store_attributes(v);
+    } else if (auto const replacement = std::get_if<NeighborsReplacement>(&entry)) {
+        auto const v = replacement->vertex;
+        _remove_from_statistics(v);
+        v->_neighbors.assign_unique(replacement->neighbors.begin(), replacement->neighbors.end());
+        _add_to_statistics(v);
+        _store_attributes(v);
+    } else if (auto const phase_change = std::get_if<PhaseChange>(&entry)) {
+        phase_change->vertex->set_phase(phase_change->phase);
+    } else if (auto const type_change = std::get_if<TypeChange>(&entry)) {
+        type_change->vertex->set_type(type_change->type);
+    } else if (auto const qubit_change = std::get_if<QubitChange>(&entry)) {
+        qubit_change->vertex->set_qubit(qubit_change->qubit);
+    } else if (auto const column_change = std::get_if<ColumnChange>(&entry)) {
+        column_change->vertex->set_col(column_change->col);
+    } else if (auto const id_change = std::get_if<IdChange>(&entry)) {
+        id_change->vertex->set_id(id_change->id);
+    }
+}
+
+}  // namespace qsyn::zx
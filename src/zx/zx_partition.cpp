@@ -12,9 +12,11 @@
 #include <algorithm>
 #include <climits>
 #include <cstdint>
+#include <numeric>
 #include <stack>
 #include <tl/enumerate.hpp>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 #include "./zx_def.hpp"
@@ -38,13 +40,15 @@ struct DirectionalZXCutHash {
 };
 
 /**
- * @brief Creates a list of subgraphs from a list of partitions
+ * @brief Creates a list of subgraphs from a list of partitions. The vertices
+ *        of each partition are copied into the subgraph, and each edge crossing
+ *        the partitions is replaced by a pair of boundary vertices.
  *
  * @param partitions The list of partitions to split the graph into
  *
  * @return A pair of the list of subgraphs and the list of cuts between the subgraphs
  */
-std::pair<std::vector<ZXGraph*>, std::vector<ZXCut>> ZXGraph::create_subgraphs(std::vector<ZXVertexList> partitions) {
+std::pair<std::vector<ZXGraph*>, std::vector<ZXCut>> ZXGraph::create_subgraphs(std::vector<ZXVertexList> const& partitions) const {
     std::vector<ZXGraph*> subgraphs;
     // stores the two sides of the cut and the edge type
     ZXCutSet inner_cuts;
@@ -52,57 +56,53 @@ std::pair<std::vector<ZXGraph*>, std::vector<ZXCut>> ZXGraph::create_subgraphs(s
     std::vector<ZXCut> outer_cuts;
     std::unordered_map<ZXCut, ZXVertex*, DirectionalZXCutHash> cut_to_boundary;
 
-    auto const primary_inputs  = get_inputs();
-    auto const primary_outputs = get_outputs();
-
     // by pass the output qubit id collision check in the copy constructor
     int next_boundary_qubit_id = INT_MIN;
 
-    for (auto& partition : partitions) {
-        ZXVertexList subgraph_inputs;
-        ZXVertexList subgraph_outputs;
-        std::vector<ZXVertex*> boundary_vertices;
+    for (auto const& partition : partitions) {
+        auto subgraph = new ZXGraph();
+        subgraph->_vertex_pool.reserve(partition.size());
 
-        size_t next_vertex_id = 0;
+        std::unordered_map<ZXVertex*, ZXVertex*> old_v2new_v_map;
         for (auto const& vertex : partition) {
-            vertex->set_id(next_vertex_id);
-            next_vertex_id++;
+            old_v2new_v_map[vertex] = subgraph->add_vertex(vertex->get_qubit(), vertex->get_type(), vertex->get_phase(), vertex->get_col());
         }
 
         for (auto const& vertex : partition) {
-            if (primary_inputs.contains(vertex)) subgraph_inputs.insert(vertex);
-            if (primary_outputs.contains(vertex)) subgraph_outputs.insert(vertex);
-
-            std::vector<NeighborPair> neighbors_to_remove;
-            std::vector<NeighborPair> neighbors_to_add;
-            for (auto const& [neighbor, edgeType] : this->get_neighbors(vertex)) {
-                if (!partition.contains(neighbor)) {
-                    auto boundary = new ZXVertex(next_vertex_id++, next_boundary_qubit_id++, VertexType::boundary);
-                    inner_cuts.emplace(vertex, neighbor, edgeType);
-                    cut_to_boundary[{vertex, neighbor, edgeType}] = boundary;
+            ZXVertex* const new_vertex = old_v2new_v_map.at(vertex);
+            if (_inputs.contains(vertex)) {
+                subgraph->_inputs.insert(new_vertex);
+                subgraph->_input_list[new_vertex->get_qubit()] = new_vertex;
+            }
+            if (_outputs.contains(vertex)) {
+                subgraph->_outputs.insert(new_vertex);
+                subgraph->_output_list[new_vertex->get_qubit()] = new_vertex;
+            }
 
-                    neighbors_to_remove.push_back({neighbor, edgeType});
-                    neighbors_to_add.push_back({boundary, edgeType});
+            // the edges to the boundaries are placed after the internal edges
+            std::vector<NeighborPair> neighbors_to_boundaries;
+            for (auto const& [neighbor, edge_type] : this->get_neighbors(vertex)) {
+                if (partition.contains(neighbor)) {
+                    _add_neighbor(new_vertex, old_v2new_v_map.at(neighbor), edge_type);
+                    continue;
+                }
+                ZXVertex* const boundary = subgraph->add_vertex(next_boundary_qubit_id++, VertexType::boundary);
+                inner_cuts.emplace(vertex, neighbor, edge_type);
+                cut_to_boundary[{vertex, neighbor, edge_type}] = boundary;
 
-                    boundary->_neighbors.emplace(vertex, edgeType);
+                _add_neighbor(boundary, new_vertex, edge_type);
+                neighbors_to_boundaries.emplace_back(boundary, edge_type);
 
-                    boundary_vertices.push_back(boundary);
-                    subgraph_outputs.insert(boundary);
-                }
+                subgraph->_outputs.insert(boundary);
+                subgraph->_output_list[boundary->get_qubit()] = boundary;
             }
 
-            for (auto const& neighbor_pair : neighbors_to_add) {
-                vertex->_neighbors.emplace(neighbor_pair);
-            }
-            for (auto const& neighbor_pair : neighbors_to_remove) {
-                vertex->_neighbors.erase(neighbor_pair);
+            for (auto const& neighbor_pair : neighbors_to_boundaries) {
+                _add_neighbor(new_vertex, neighbor_pair.first, neighbor_pair.second);
             }
         }
 
-        for (auto const& vertex : boundary_vertices) {
-            partition.insert(vertex);
-        }
-        subgraphs.push_back(new ZXGraph(partition, subgraph_inputs, subgraph_outputs));
+        subgraphs.push_back(subgraph);
     }
 
     for (auto&& [i, g] : tl::views::enumerate(subgraphs)) {
@@ -116,9 +116,6 @@ std::pair<std::vector<ZXGraph*>, std::vector<ZXCut>> ZXGraph::create_subgraphs(s
         outer_cuts.push_back({b1, b2, edge_type});
     }
 
-    // ownership of the vertices is transferred to the subgraphs
-    release();
-
     return {subgraphs, outer_cuts};
 }
 
@@ -128,48 +125,78 @@ std::pair<std::vector<ZXGraph*>, std::vector<ZXCut>> ZXGraph::create_subgraphs(s
  *
  * @param subgraphs The list of subgraphs to merge
  * @param cuts The list of cuts between the subgraph (boundary vertices)
+ * @param cut_vertices If not null, the vertices of the merged graph next to the cuts are inserted here
  *
  * @return The merged ZXGraph
  *
  */
-ZXGraph* ZXGraph::from_subgraphs(std::vector<ZXGraph*> const& subgraphs, std::vector<ZXCut> const& cuts) {
-    ZXVertexList vertices;
-    ZXVertexList inputs;
-    ZXVertexList outputs;
-
-    for (auto subgraph : subgraphs) {
-        vertices.insert(subgraph->get_vertices().begin(), subgraph->get_vertices().end());
-        inputs.insert(subgraph->get_inputs().begin(), subgraph->get_inputs().end());
-        outputs.insert(subgraph->get_outputs().begin(), subgraph->get_outputs().end());
-    }
-
+ZXGraph* ZXGraph::from_subgraphs(std::vector<ZXGraph*> const& subgraphs, std::vector<ZXCut> const& cuts, ZXVertexList* cut_vertices) {
+    // reconnect the vertices across the cuts in place; the boundary vertices are
+    // left dangling and discarded together with the subgraphs
+    std::unordered_set<ZXVertex*> cut_boundaries;
+    std::vector<ZXVertex*> cut_neighbors;
     for (auto [b1, b2, edgeType] : cuts) {
         auto [v1, e1] = *b1->_neighbors.begin();
         auto [v2, e2] = *b2->_neighbors.begin();
+        if (cut_vertices != nullptr) {
+            cut_neighbors.emplace_back(v1);
+            cut_neighbors.emplace_back(v2);
+        }
 
         auto const new_edge_type = zx::concat_edge(e1, e2, edgeType);
 
-        v1->_neighbors.erase({b1, e1});
-        v2->_neighbors.erase({b2, e2});
-        vertices.erase(b1);
-        vertices.erase(b2);
-        inputs.erase(b1);
-        inputs.erase(b2);
-        outputs.erase(b1);
-        outputs.erase(b2);
-        v1->_neighbors.emplace(v2, new_edge_type);
-        v2->_neighbors.emplace(v1, new_edge_type);
-        delete b1;
-        delete b2;
+        _remove_neighbor(v1, b1, e1);
+        _remove_neighbor(v2, b2, e2);
+        _add_neighbor(v1, v2, new_edge_type);
+        _add_neighbor(v2, v1, new_edge_type);
+        cut_boundaries.insert(b1);
+        cut_boundaries.insert(b2);
+    }
+
+    auto merged_graph = new ZXGraph();
+    merged_graph->_vertex_pool.reserve(std::transform_reduce(
+        subgraphs.begin(), subgraphs.end(), size_t{0}, std::plus{}, [](ZXGraph* subgraph) { return subgraph->get_num_vertices(); }));
+
+    std::unordered_map<ZXVertex*, ZXVertex*> old_v2new_v_map;
+    for (auto subgraph : subgraphs) {
+        for (auto const& v : subgraph->get_vertices()) {
+            if (cut_boundaries.contains(v)) continue;
+            old_v2new_v_map[v] = merged_graph->add_vertex(v->get_qubit(), v->get_type(), v->get_phase(), v->get_col());
+        }
+    }
+
+    for (auto subgraph : subgraphs) {
+        for (auto const& v : subgraph->get_vertices()) {
+            if (cut_boundaries.contains(v)) continue;
+            ZXVertex* const new_v = old_v2new_v_map.at(v);
+            for (auto const& [nb, etype] : subgraph->get_neighbors(v)) {
+                _add_neighbor(new_v, old_v2new_v_map.at(nb), etype);
+            }
+        }
+        for (auto const& v : subgraph->get_inputs()) {
+            if (cut_boundaries.contains(v)) continue;
+            merged_graph->_inputs.insert(old_v2new_v_map.at(v));
+            merged_graph->_input_list[v->get_qubit()] = old_v2new_v_map.at(v);
+        }
+        for (auto const& v : subgraph->get_outputs()) {
+            if (cut_boundaries.contains(v)) continue;
+            merged_graph->_outputs.insert(old_v2new_v_map.at(v));
+            merged_graph->_output_list[v->get_qubit()] = old_v2new_v_map.at(v);
+        }
+    }
+
+    if (cut_vertices != nullptr) {
+        for (auto v : cut_neighbors) {
+            // a vertex may have been reduced away, leaving a boundary next to the cut
+            if (auto const it = old_v2new_v_map.find(v); it != old_v2new_v_map.end()) cut_vertices->insert(it->second);
+        }
     }
 
     for (auto subgraph : subgraphs) {
-        // ownership of the vertices is transferred to the merged graph
-        subgraph->release();
         delete subgraph;
     }
 
-    return new ZXGraph(vertices, inputs, outputs);
+    return merged_graph;
 }
 
 /*****************************************************/
@@ -178,7 +205,7 @@ ZXGraph* ZXGraph::from_subgraphs(std::vector<ZXGraph*> const& subgraphs, std::ve
 
 namespace detail {
 
-std::pair<ZXVertexList, ZXVertexList> kl_bipartition(ZXGraph const& graph, ZXVertexList vertices);
+std::pair<ZXVertexList, ZXVertexList> kl_bipartition(ZXGraph const& graph, ZXVertexList vertices, ZXVertexList const& previous_cut_vertices);
 
 }
 /**
@@ -186,16 +213,19 @@ std::pair<ZXVertexList, ZXVertexList> kl_bipartition(ZXGraph const& graph, ZXVer
  *
  * @param graph The graph to partition.
  * @param numPartitions The number of partitions to split the graph into.
+ * @param previous_cut_vertices The vertices next to the cuts of a previous partition, if any. The
+ *        bisections start with these vertices and the ones closest to them on the same side, so
+ *        that the new cuts are shifted away from the previous ones.
  *
  * @return A vector of vertex lists, each representing a partition.
  */
-std::vector<ZXVertexList> kl_partition(ZXGraph const& graph, size_t n_partitions) {
+std::vector<ZXVertexList> kl_partition(ZXGraph const& graph, size_t n_partitions, ZXVertexList const& previous_cut_vertices) {
     std::vector<ZXVertexList> partitions = {graph.get_vertices()};
     size_t count                         = 1;
     while (count < n_partitions) {
         std::vector<ZXVertexList> new_partitions;
         for (auto& partition : partitions) {
-            auto [p1, p2] = detail::kl_bipartition(graph, partition);
+            auto [p1, p2] = detail::kl_bipartition(graph, partition, previous_cut_vertices);
             partition     = p1;
             new_partitions.push_back(p2);
             if (++count == n_partitions) break;
@@ -205,20 +235,59 @@ std::vector<ZXVertexList> kl_partition(ZXGraph const& graph, size_t n_partitions
     return partitions;
 }
 
-std::pair<ZXVertexList, ZXVertexList> detail::kl_bipartition(ZXGraph const& graph, ZXVertexList vertices) {
+namespace {
+
+/**
+ * @brief Order the vertices by their distance to the sources, in breadth-first order. The vertices
+ *        not reachable from the sources within `vertices` are placed last.
+ *
+ */
+std::vector<ZXVertex*> order_by_distance(ZXGraph const& graph, ZXVertexList const& vertices, ZXVertexList const& sources) {
+    std::vector<ZXVertex*> order;
+    order.reserve(vertices.size());
+    std::unordered_set<ZXVertex*> visited;
+    for (auto v : vertices) {
+        if (sources.contains(v) && visited.insert(v).second) order.emplace_back(v);
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (auto const& [neighbor, _] : graph.get_neighbors(order[i])) {
+            if (vertices.contains(neighbor) && visited.insert(neighbor).second) order.emplace_back(neighbor);
+        }
+    }
+    for (auto v : vertices) {
+        if (!visited.contains(v)) order.emplace_back(v);
+    }
+    return order;
+}
+
+}  // namespace
+
+std::pair<ZXVertexList, ZXVertexList> detail::kl_bipartition(ZXGraph const& graph, ZXVertexList vertices, ZXVertexList const& previous_cut_vertices) {
     using SwapPair = std::pair<ZXVertex*, ZXVertex*>;
 
     ZXVertexList partition1 = ZXVertexList();
     ZXVertexList partition2 = ZXVertexList();
 
-    bool toggle = false;
-    for (auto v : vertices) {
-        if (toggle) {
-            partition1.insert(v);
-        } else {
-            partition2.insert(v);
+    if (std::ranges::any_of(vertices, [&](ZXVertex* v) { return previous_cut_vertices.contains(v); })) {
+        // the half closest to the previous cuts starts on one side, so the previous cuts lie inside it
+        auto const order = order_by_distance(graph, vertices, previous_cut_vertices);
+        for (auto const& [i, v] : tl::views::enumerate(order)) {
+            if (i < (order.size() + 1) / 2) {
+                partition2.insert(v);
+            } else {
+                partition1.insert(v);
+            }
+        }
+    } else {
+        bool toggle = false;
+        for (auto v : vertices) {
+            if (toggle) {
+                partition1.insert(v);
+            } else {
+                partition2.insert(v);
+            }
+            toggle = !toggle;
         }
-        toggle = !toggle;
     }
 
     std::unordered_map<ZXVertex*, int> d_values;
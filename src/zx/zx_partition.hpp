@@ -15,7 +15,7 @@ namespace qsyn {
 
 namespace zx {
 
-std::vector<ZXVertexList> kl_partition(ZXGraph const& graph, size_t n_partitions);
+std::vector<ZXVertexList> kl_partition(ZXGraph const& graph, size_t n_partitions, ZXVertexList const& previous_cut_vertices = {});
 
 }
 
@@ -7,64 +7,114 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cassert>
 #include <cstddef>
-#include <list>
-#include <stack>
-#include <unordered_map>
+#include <limits>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include "./zxgraph.hpp"
 
 namespace qsyn::zx {
 
+/**
+ * @brief Reserve `n` consecutive fresh marks for the traversal, change and gadget marks of the vertices.
+ *        Since the marks are 32-bit, the marks of the vertices are reset before the counter wraps around.
+ *
+ * @param n the number of marks to reserve
+ * @return the first of the reserved marks
+ */
+ZXVertex::Mark ZXGraph::_new_traversal_marks(size_t n) const {
+    assert(n < std::numeric_limits<ZXVertex::Mark>::max() / 2);
+    if (_global_traversal_counter > std::numeric_limits<ZXVertex::Mark>::max() - n - 2) _reset_marks();
+    auto const first = _global_traversal_counter + 1;
+    _global_traversal_counter += static_cast<ZXVertex::Mark>(n);
+    return first;
+}
+
+/**
+ * @brief Reset the marks of the vertices, including the removed ones that a rollback may put back,
+ *        and restart the mark counter. The change mark and the gadget mark are drawn anew, so a vertex
+ *        already recorded as changed may be recorded again, which is harmless.
+ *
+ */
+void ZXGraph::_reset_marks() const {
+    auto const reset = [](ZXVertex* v) {
+        v->_bookkeeping.traversal_mark = 0;
+        v->_bookkeeping.change_mark    = 0;
+        v->_bookkeeping.gadget_mark    = 0;
+    };
+    for (auto const& v : _vertices) reset(v);
+    for (auto const& entry : _journal) {
+        if (auto const removal = std::get_if<VertexRemoval>(&entry)) reset(removal->vertex);
+    }
+    _global_traversal_counter = 0;
+    _change_mark              = ++_global_traversal_counter;
+    _gadget_index.mark        = ++_global_traversal_counter;
+}
+
 /**
  * @brief Update Topological Order
  *
  */
 std::vector<ZXVertex*> ZXGraph::create_topological_order() const {
+    return _get_topological_order();
+}
+
+/**
+ * @brief Get the topological order, computing it only if the graph has changed since the last call
+ *
+ * @return std::vector<ZXVertex*> const&
+ */
+std::vector<ZXVertex*> const& ZXGraph::_get_topological_order() const {
+    if (_topological_order.has_value()) return *_topological_order;
+
     std::vector<ZXVertex*> topological_order;
-    std::unordered_set<ZXVertex*> dfs_counters;
+    auto const mark = _new_traversal_mark();
     for (auto const& v : _inputs) {
-        if (!dfs_counters.contains(v))
-            _dfs(dfs_counters, topological_order, v);
+        if (v->_bookkeeping.traversal_mark != mark)
+            _dfs(mark, topological_order, v);
     }
     for (auto const& v : _outputs) {
-        if (!dfs_counters.contains(v))
-            _dfs(dfs_counters, topological_order, v);
+        if (v->_bookkeeping.traversal_mark != mark)
+            _dfs(mark, topological_order, v);
     }
     reverse(topological_order.begin(), topological_order.end());
     spdlog::trace("Topological order from first input: {}", fmt::join(topological_order | std::views::transform([](auto const& v) { return v->get_id(); }), " "));
     spdlog::trace("Size of topological order: {}", topological_order.size());
 
-    return topological_order;
+    return _topological_order.emplace(std::move(topological_order));
 }
 
 /**
  * @brief Performing DFS from currentVertex
  *
+ * @param mark the mark of the vertices visited in this traversal
  * @param currentVertex
  */
-void ZXGraph::_dfs(std::unordered_set<ZXVertex*>& visited_vertices, std::vector<ZXVertex*>& topological_order, ZXVertex* curr_vertex) const {
-    std::stack<std::pair<bool, ZXVertex*>> dfs;
+void ZXGraph::_dfs(ZXVertex::Mark mark, std::vector<ZXVertex*>& topological_order, ZXVertex* curr_vertex) const {
+    std::vector<std::pair<bool, ZXVertex*>> dfs;
 
-    if (!visited_vertices.contains(curr_vertex)) {
-        dfs.emplace(false, curr_vertex);
+    if (curr_vertex->_bookkeeping.traversal_mark != mark) {
+        dfs.emplace_back(false, curr_vertex);
     }
     while (!dfs.empty()) {
-        auto [is_visited, vertex] = dfs.top();
-        dfs.pop();
+        auto [is_visited, vertex] = dfs.back();
+        dfs.pop_back();
         if (is_visited) {
             topological_order.emplace_back(vertex);
             continue;
         }
-        if (visited_vertices.contains(vertex)) {
+        if (vertex->_bookkeeping.traversal_mark == mark) {
             continue;
         }
-        visited_vertices.emplace(vertex);
-        dfs.emplace(true, vertex);
+        vertex->_bookkeeping.traversal_mark = mark;
+        dfs.emplace_back(true, vertex);
 
         for (auto const& [nb, _] : this->get_neighbors(vertex)) {
-            if (!visited_vertices.contains(nb)) {
-                dfs.emplace(false, nb);
+            if (nb->_bookkeeping.traversal_mark != mark) {
+                dfs.emplace_back(false, nb);
             }
         }
     }
@@ -75,15 +125,15 @@ void ZXGraph::_dfs(std::unordered_set<ZXVertex*>& visited_vertices, std::vector<
  *
  */
 std::vector<ZXVertex*> ZXGraph::create_breadth_level() const {
-    std::unordered_set<ZXVertex*> bfs_counters;
     std::vector<ZXVertex*> breadth_order;
+    auto const mark = _new_traversal_mark();
     for (auto const& v : _inputs) {
-        if (!bfs_counters.contains(v))
-            _bfs(bfs_counters, breadth_order, v);
+        if (v->_bookkeeping.traversal_mark != mark)
+            _bfs(mark, breadth_order, v);
     }
     for (auto const& v : _outputs) {
-        if (!bfs_counters.contains(v))
-            _bfs(bfs_counters, breadth_order, v);
+        if (v->_bookkeeping.traversal_mark != mark)
+            _bfs(mark, breadth_order, v);
     }
 
     return breadth_order;
@@ -92,24 +142,23 @@ std::vector<ZXVertex*> ZXGraph::create_breadth_level() const {
 /**
  * @brief Performing BFS from currentVertex
  *
+ * @param mark the mark of the vertices visited in this traversal
  * @param current_vertex
  */
-void ZXGraph::_bfs(std::unordered_set<ZXVertex*>& visited_vertices, std::vector<ZXVertex*>& topological_order, ZXVertex* curr_vertex) const {
-    std::list<ZXVertex*> queue;
-
-    visited_vertices.emplace(curr_vertex);
-    queue.emplace_back(curr_vertex);
+void ZXGraph::_bfs(ZXVertex::Mark mark, std::vector<ZXVertex*>& breadth_order, ZXVertex* curr_vertex) const {
+    // the vertices in `breadth_order` after `front` serve as the queue
+    auto front = breadth_order.size();
 
-    while (!queue.empty()) {
-        ZXVertex* s = queue.front();
+    curr_vertex->_bookkeeping.traversal_mark = mark;
+    breadth_order.emplace_back(curr_vertex);
 
-        topological_order.emplace_back(s);
-        queue.pop_front();
+    while (front < breadth_order.size()) {
+        ZXVertex* s = breadth_order[front++];
 
         for (auto [adjecent, _] : this->get_neighbors(s)) {
-            if (!visited_vertices.contains(adjecent)) {
-                visited_vertices.emplace(adjecent);
-                queue.emplace_back(adjecent);
+            if (adjecent->_bookkeeping.traversal_mark != mark) {
+                adjecent->_bookkeeping.traversal_mark = mark;
+                breadth_order.emplace_back(adjecent);
             }
         }
     }
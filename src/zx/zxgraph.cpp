@@ -10,12 +10,16 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
 #include <numeric>
 #include <ranges>
 
 #include "./zx_def.hpp"
 #include "tl/enumerate.hpp"
 #include "util/boolean_matrix.hpp"
+#include "util/util.hpp"
 
 namespace qsyn::zx {
 
@@ -23,60 +27,498 @@ namespace qsyn::zx {
 /*   class ZXGraph Getter and setter functions       */
 /*****************************************************/
 
+ZXGraph::ZXGraph(ZXGraph const& other) : _filename{other._filename}, _procedures{other._procedures} {
+    auto const num_vertices = other.get_num_vertices();
+    // allocate the storage of all vertices in one go
+    _vertex_pool.reserve(num_vertices);
+
+    // index the vertices of `other` by their ids. The ids are dense unless the
+    // graph is read with its original ids, in which case we fall back to a hash map
+    size_t max_id = 0;
+    for (auto const& v : other._vertices) max_id = std::max(max_id, v->get_id());
+    bool const ids_are_dense = max_id < 4 * num_vertices + 1024;
+    std::vector<size_t> id_to_index(ids_are_dense ? max_id + 1 : 0);
+    std::unordered_map<size_t, size_t> sparse_id_to_index;
+    auto const index_of = [&](ZXVertex const* v) {
+        return ids_are_dense ? id_to_index[v->get_id()] : sparse_id_to_index.at(v->get_id());
+    };
+
+    std::vector<ZXVertex*> clones;
+    clones.reserve(num_vertices);
+    for (auto const& v : other._vertices) {
+        if (ids_are_dense) {
+            id_to_index[v->get_id()] = clones.size();
+        } else {
+            sparse_id_to_index.emplace(v->get_id(), clones.size());
+        }
+        if (!v->is_boundary()) {
+            clones.emplace_back(this->add_vertex(v->get_qubit(), v->get_type(), v->get_phase(), v->get_col()));
+        } else if (other._inputs.contains(v)) {
+            clones.emplace_back(this->add_input(v->get_qubit(), v->get_col()));
+        } else {
+            clones.emplace_back(this->add_output(v->get_qubit(), v->get_col()));
+        }
+    }
+
+    // Lay out the neighbors of each clone contiguously, in the same order as
+    // adding the edges one by one in the order of `for_each_edge` would produce.
+    // The first pass counts the degrees and the second one fills in the neighbors.
+    std::vector<size_t> offsets(num_vertices + 1, 0);
+    for (auto const& [i, v] : tl::views::enumerate(other._vertices)) {
+        for (auto const& [nb, etype] : other.get_neighbors(v)) {
+            if (nb->get_id() <= v->get_id()) continue;
+            offsets[i + 1]++;
+            offsets[index_of(nb) + 1]++;
+        }
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<NeighborPair> neighbors(offsets.back());
+    std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+    for (auto const& [i, v] : tl::views::enumerate(other._vertices)) {
+        for (auto const& [nb, etype] : other.get_neighbors(v)) {
+            if (nb->get_id() <= v->get_id()) continue;
+            auto const j            = index_of(nb);
+            neighbors[cursors[i]++] = {clones[j], etype};
+            neighbors[cursors[j]++] = {clones[i], etype};
+        }
+    }
+
+    for (auto const& [i, clone] : tl::views::enumerate(clones)) {
+        _remove_from_statistics(clone);
+        clone->_neighbors.assign_unique(neighbors.begin() + gsl::narrow<std::ptrdiff_t>(offsets[i]), neighbors.begin() + gsl::narrow<std::ptrdiff_t>(offsets[i + 1]));
+        _add_to_statistics(clone);
+        _store_attributes(clone);
+    }
+}
+
 /**
- * @brief Construct a new ZXGraph object from a list of vertices.
+ * @brief Add the contribution of `v` to the graph statistics
  *
- * @param vertices the vertices
- * @param inputs the inputs. Note that the inputs must be a subset of the vertices.
- * @param outputs the outputs. Note that the outputs must be a subset of the vertices.
- * @param id
+ * @param v
+ */
+void ZXGraph::_add_to_statistics(ZXVertex const* v) {
+    auto const degree = v->_neighbors.size();
+    if (v->get_phase().denominator() == 4) _statistics.num_t_vertices++;
+    if (!v->is_clifford()) _statistics.num_non_clifford_vertices++;
+    if (!v->is_boundary() && degree == 1) _statistics.num_gadgets++;
+    _statistics.sum_of_degrees += degree;
+    _statistics.sum_of_squared_degrees += degree * degree;
+}
+
+/**
+ * @brief Remove the contribution of `v` from the graph statistics
+ *
+ * @param v
+ */
+void ZXGraph::_remove_from_statistics(ZXVertex const* v) {
+    auto const degree = v->_neighbors.size();
+    if (v->get_phase().denominator() == 4) _statistics.num_t_vertices--;
+    if (!v->is_clifford()) _statistics.num_non_clifford_vertices--;
+    if (!v->is_boundary() && degree == 1) _statistics.num_gadgets--;
+    _statistics.sum_of_degrees -= degree;
+    _statistics.sum_of_squared_degrees -= degree * degree;
+}
+
+/**
+ * @brief Compute the graph statistics from scratch
+ *
+ * @return ZXGraph::Statistics
  */
-ZXGraph::ZXGraph(ZXVertexList const& vertices,
-                 ZXVertexList const& inputs,
-                 ZXVertexList const& outputs) : _inputs{inputs}, _outputs{outputs}, _vertices{vertices} {
-    for (auto v : _vertices) {
-        v->set_id(_next_v_id);
-        _next_v_id++;
+ZXGraph::Statistics ZXGraph::_scan_statistics() const {
+    Statistics statistics;
+    auto const& types        = _attributes.types;
+    auto const& denominators = _attributes.phase_denominators;
+    auto const& degrees      = _attributes.degrees;
+    for (size_t i = 0; i < _attributes.size(); ++i) {
+        statistics.num_t_vertices += denominators[i] == 4;
+        statistics.num_non_clifford_vertices += denominators[i] > 2;
+        statistics.num_gadgets += types[i] != VertexType::boundary && degrees[i] == 1;
+        statistics.sum_of_degrees += degrees[i];
+        statistics.sum_of_squared_degrees += degrees[i] * degrees[i];
     }
-    for (auto v : _inputs) {
-        assert(vertices.contains(v));
-        _input_list[v->get_qubit()] = v;
+    return statistics;
+}
+
+/**
+ * @brief In debug builds, check that the incrementally maintained statistics
+ *        agree with the ones computed from scratch.
+ *
+ */
+void ZXGraph::_check_statistics() const {
+#ifdef QSYN_DEBUG
+    DVLAB_ASSERT(_statistics == _scan_statistics(), "ZXGraph statistics are out of sync with the graph");
+#endif
+}
+
+/**
+ * @brief Append the attributes of `v` to the attribute arrays
+ *
+ * @param v
+ */
+void ZXGraph::_append_attributes(ZXVertex* v) {
+    v->_bookkeeping.slot = gsl::narrow<std::uint32_t>(_attributes.size());
+    _attributes.vertices.emplace_back(v);
+    _attributes.types.emplace_back();
+    _attributes.phase_numerators.emplace_back();
+    _attributes.phase_denominators.emplace_back();
+    _attributes.qubits.emplace_back();
+    _attributes.cols.emplace_back();
+    _attributes.degrees.emplace_back();
+    _store_attributes(v);
+}
+
+/**
+ * @brief Copy the attributes of `v` to its slot in the attribute arrays
+ *
+ * @param v
+ */
+void ZXGraph::_store_attributes(ZXVertex* v) {
+    if (_is_tracking_changes && v->_bookkeeping.change_mark != _change_mark) {
+        v->_bookkeeping.change_mark = _change_mark;
+        _changed_vertex_ids.emplace_back(v->_id);
     }
-    for (auto v : _outputs) {
-        assert(vertices.contains(v));
-        _output_list[v->get_qubit()] = v;
+    _record_gadget_change(v);
+    auto const slot                      = v->_bookkeeping.slot;
+    _attributes.types[slot]              = v->_type;
+    _attributes.phase_numerators[slot]   = v->_phase.numerator();
+    _attributes.phase_denominators[slot] = v->_phase.denominator();
+    _attributes.qubits[slot]             = v->_qubit;
+    _attributes.cols[slot]               = v->_col;
+    _attributes.degrees[slot]            = v->_neighbors.size();
+}
+
+/**
+ * @brief Mark the slot as removed
+ *
+ * @param slot
+ */
+void ZXGraph::_clear_attributes(size_t slot) {
+    _record_gadget_change(_attributes.vertices[slot]);
+    _attributes.vertices[slot]           = nullptr;
+    _attributes.types[slot]              = VertexType::boundary;
+    _attributes.phase_numerators[slot]   = 0;
+    _attributes.phase_denominators[slot] = 1;
+    _attributes.qubits[slot]             = 0;
+    _attributes.cols[slot]               = 0;
+    _attributes.degrees[slot]            = 0;
+}
+
+/**
+ * @brief Squeeze out the removed slots once they outnumber the vertices. The slots
+ *        are kept in place under a checkpoint so that removed vertices can be put back.
+ *
+ */
+void ZXGraph::_compact_attributes() {
+    if (is_journaling() || _attributes.size() < 2 * _vertices.size() + 16) return;
+
+    size_t n_kept = 0;
+    for (size_t i = 0; i < _attributes.size(); ++i) {
+        auto const v = _attributes.vertices[i];
+        if (v == nullptr) continue;
+        v->_bookkeeping.slot                   = gsl::narrow<std::uint32_t>(n_kept);
+        _attributes.vertices[n_kept]           = v;
+        _attributes.types[n_kept]              = _attributes.types[i];
+        _attributes.phase_numerators[n_kept]   = _attributes.phase_numerators[i];
+        _attributes.phase_denominators[n_kept] = _attributes.phase_denominators[i];
+        _attributes.qubits[n_kept]             = _attributes.qubits[i];
+        _attributes.cols[n_kept]               = _attributes.cols[i];
+        _attributes.degrees[n_kept]            = _attributes.degrees[i];
+        ++n_kept;
     }
+    _attributes.vertices.resize(n_kept);
+    _attributes.types.resize(n_kept);
+    _attributes.phase_numerators.resize(n_kept);
+    _attributes.phase_denominators.resize(n_kept);
+    _attributes.qubits.resize(n_kept);
+    _attributes.cols.resize(n_kept);
+    _attributes.degrees.resize(n_kept);
 }
 
-ZXGraph::ZXGraph(ZXGraph const& other) : _filename{other._filename}, _procedures{other._procedures} {
-    std::unordered_map<ZXVertex*, ZXVertex*> old_v2new_v_map;
+/**
+ * @brief Check that the attribute arrays mirror the vertices in order
+ *
+ * @return true if the arrays are in sync with the vertices
+ */
+bool ZXGraph::_check_attributes() const {
+    if (std::ranges::count_if(_attributes.vertices, [](ZXVertex* v) { return v != nullptr; }) != std::ssize(_vertices)) return false;
+    size_t last_slot = 0;
+    for (auto const& [i, v] : tl::views::enumerate(_vertices)) {
+        auto const slot = v->_bookkeeping.slot;
+        if (slot >= _attributes.size() || _attributes.vertices[slot] != v) return false;
+        if (i > 0 && slot <= last_slot) return false;
+        if (_attributes.types[slot] != v->get_type() ||
+            _attributes.phase_numerators[slot] != v->get_phase().numerator() ||
+            _attributes.phase_denominators[slot] != v->get_phase().denominator() ||
+            _attributes.qubits[slot] != v->get_qubit() ||
+            _attributes.cols[slot] != v->get_col() ||
+            _attributes.degrees[slot] != v->_neighbors.size()) return false;
+        last_slot = slot;
+    }
+    return true;
+}
 
-    for (auto& v : other._vertices) {
-        if (v->is_boundary()) {
-            if (other._inputs.contains(v))
-                old_v2new_v_map[v] = this->add_input(v->get_qubit(), v->get_col());
-            else
-                old_v2new_v_map[v] = this->add_output(v->get_qubit(), v->get_col());
-        } else if (v->is_z() || v->is_x() || v->is_hbox()) {
-            old_v2new_v_map[v] = this->add_vertex(v->get_qubit(), v->get_type(), v->get_phase(), v->get_col());
-        }
+/**
+ * @brief Start recording the vertices whose attributes or neighbors change
+ *
+ */
+void ZXGraph::start_tracking_changes() {
+    _is_tracking_changes = true;
+    _change_mark         = _new_traversal_mark();
+    _changed_vertex_ids.clear();
+}
+
+/**
+ * @brief Stop recording the changed vertices
+ *
+ */
+void ZXGraph::stop_tracking_changes() {
+    _is_tracking_changes = false;
+    _changed_vertex_ids.clear();
+}
+
+/**
+ * @brief Get the vertices changed since the last call and their neighbors, in the order of
+ *        `get_vertices()`, and reset the record. Since the rewrite rules only inspect a vertex and
+ *        its neighbors, a match can only appear in this neighborhood.
+ *
+ * @param max_size give up if the neighborhood has more vertices than this
+ * @return the changed vertices and their neighbors, or std::nullopt if there are too many of them
+ */
+std::optional<std::vector<ZXVertex*>> ZXGraph::take_changed_neighborhood(size_t max_size) {
+    std::vector<ZXVertex*> neighborhood;
+    auto const mark  = _new_traversal_mark();
+    auto const visit = [&neighborhood, mark](ZXVertex* v) {
+        if (v->_bookkeeping.traversal_mark == mark) return;
+        v->_bookkeeping.traversal_mark = mark;
+        neighborhood.emplace_back(v);
+    };
+    for (auto const& id : _changed_vertex_ids) {
+        auto const v = find_vertex_by_id(id);
+        if (v == nullptr) continue;  // removed since
+        visit(v);
+        for (auto const& [nb, _] : v->_neighbors) visit(nb);
+        if (neighborhood.size() > max_size) break;
     }
+    _changed_vertex_ids.clear();
+    _change_mark = _new_traversal_mark();
 
-    other.for_each_edge([&old_v2new_v_map, this](EdgePair const& epair) {
-        this->add_edge(old_v2new_v_map[epair.first.first], old_v2new_v_map[epair.first.second], epair.second);
-    });
+    if (neighborhood.size() > max_size) return std::nullopt;
+
+    std::ranges::sort(neighborhood, [](ZXVertex const* a, ZXVertex const* b) { return a->_bookkeeping.slot < b->_bookkeeping.slot; });
+    return neighborhood;
+}
+
+namespace {
+
+/**
+ * @brief A well-mixed hash of the vertex, i.e., the finalizer of SplitMix64, so that the sums of
+ *        them over different neighborhoods hardly ever collide
+ *
+ */
+size_t gadget_signature_of(ZXVertex const* v) {
+    auto x = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(v));
+    x      = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x      = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<size_t>(x ^ (x >> 31));
+}
+
+}  // namespace
+
+/**
+ * @brief Get the gadget leaves in the order of `get_vertices()`
+ *
+ * @return std::vector<ZXVertex*>
+ */
+std::vector<ZXVertex*> ZXGraph::get_gadget_leaves() const {
+    DVLAB_ASSERT(_is_gadget_index_current(), "The gadget index is out of date; call `update_gadget_index()` first");
+    std::vector<ZXVertex*> leaves;
+    leaves.reserve(_gadget_index.axel_of_leaf.size());
+    for (auto const& [leaf, _] : _gadget_index.axel_of_leaf) leaves.emplace_back(leaf);
+    std::ranges::sort(leaves, [](ZXVertex const* a, ZXVertex const* b) { return a->_bookkeeping.slot < b->_bookkeeping.slot; });
+    return leaves;
+}
+
+/**
+ * @brief Get the number of gadget leaves connected to `axel`, which is 0 if it is not an axel
+ *
+ * @param axel
+ * @return size_t
+ */
+size_t ZXGraph::get_num_gadget_leaves(ZXVertex* axel) const {
+    DVLAB_ASSERT(_is_gadget_index_current(), "The gadget index is out of date; call `update_gadget_index()` first");
+    auto const it = _gadget_index.axels.find(axel);
+    return it == _gadget_index.axels.end() ? 0 : it->second.num_leaves;
 }
 
 /**
- * @brief Get the number of edges in ZXGraph
+ * @brief Get the signature of the neighbors of the axel of `leaf` other than `leaf`. The gadgets
+ *        acting on the same vertices have the same signature; the converse holds but for a hash
+ *        collision, so the callers should compare the neighbors of the gadgets with equal signatures.
  *
+ * @param leaf a gadget leaf
  * @return size_t
  */
-size_t ZXGraph::get_num_edges() const {
-    return std::accumulate(_vertices.begin(), _vertices.end(), 0, [this](size_t sum, ZXVertex* v) {
-               return sum + this->get_num_neighbors(v);
-           }) /
-           2;
+size_t ZXGraph::get_gadget_group_signature(ZXVertex* leaf) const {
+    DVLAB_ASSERT(_is_gadget_index_current(), "The gadget index is out of date; call `update_gadget_index()` first");
+    auto const axel = _gadget_index.axel_of_leaf.at(leaf);
+    return _gadget_index.axels.at(axel).neighbor_signature - gadget_signature_of(leaf);
+}
+
+/**
+ * @brief Record that the gadget status of `v` or of its neighbors may have changed
+ *
+ * @param v
+ */
+void ZXGraph::_record_gadget_change(ZXVertex* v) {
+    if (!_gadget_index.is_built || v->_bookkeeping.gadget_mark == _gadget_index.mark) return;
+    v->_bookkeeping.gadget_mark = _gadget_index.mark;
+    _gadget_index.changed_vertices.emplace_back(v);
+}
+
+/**
+ * @brief Bring the gadget index up to date. A gadget only depends on the leaf and the neighbors
+ *        of the axel, so re-indexing the changed vertices as leaves and re-signing the changed axels
+ *        suffices. A removed vertex whose memory has been reused is re-indexed as the new vertex.
+ *        Builds the index from scratch on the first call.
+ *
+ */
+void ZXGraph::update_gadget_index() {
+    auto& index = _gadget_index;
+    if (index.is_built && index.changed_vertices.empty()) return;
+
+    std::vector<ZXVertex*> axels_to_sign;
+    auto const index_leaf = [&index, &axels_to_sign](ZXVertex* v) {
+        if (v->is_boundary() || v->_neighbors.size() != 1) return;
+        auto const axel = v->_neighbors.begin()->first;
+        if (!index.axel_of_leaf.emplace(v, axel).second) return;
+        if (index.axels[axel].num_leaves++ == 0) axels_to_sign.emplace_back(axel);
+    };
+
+    if (!index.is_built) {
+        index.axel_of_leaf.clear();
+        index.axels.clear();
+        for (auto const& v : _vertices) index_leaf(v);
+        index.is_built = true;
+    } else {
+        for (auto const& v : index.changed_vertices) {
+            auto const it = index.axel_of_leaf.find(v);
+            if (it == index.axel_of_leaf.end()) continue;
+            auto const axel = index.axels.find(it->second);
+            if (--axel->second.num_leaves == 0) index.axels.erase(axel);
+            index.axel_of_leaf.erase(it);
+        }
+        for (auto const& v : index.changed_vertices) {
+            if (!_vertices.contains(v)) continue;  // removed since
+            index_leaf(v);
+            if (index.axels.contains(v)) axels_to_sign.emplace_back(v);
+        }
+    }
+
+    for (auto const& axel : axels_to_sign) {
+        auto const it = index.axels.find(axel);
+        if (it == index.axels.end()) continue;
+        size_t signature = 0;
+        for (auto const& [nb, _] : axel->_neighbors) signature += gadget_signature_of(nb);
+        it->second.neighbor_signature = signature;
+    }
+
+    index.changed_vertices.clear();
+    index.mark = _new_traversal_mark();
+}
+
+/**
+ * @brief Make `v` findable by its id
+ *
+ * @param v
+ */
+void ZXGraph::_index_vertex(ZXVertex* v) {
+    auto const id = v->get_id();
+    if (id >= _id_to_vertex.size()) {
+        if (id >= 2 * _vertices.size() + 1024) {
+            _sparse_id_to_vertex[id] = v;
+            return;
+        }
+        _id_to_vertex.resize(id + 1, nullptr);
+    }
+    _id_to_vertex[id] = v;
+}
+
+/**
+ * @brief Stop `v` from being found by its id. Nothing happens if the id has been taken by another vertex.
+ *
+ * @param v
+ */
+void ZXGraph::_unindex_vertex(ZXVertex const* v) {
+    auto const id = v->get_id();
+    if (id < _id_to_vertex.size() && _id_to_vertex[id] == v) {
+        _id_to_vertex[id] = nullptr;
+        return;
+    }
+    if (auto const it = _sparse_id_to_vertex.find(id); it != _sparse_id_to_vertex.end() && it->second == v) {
+        _sparse_id_to_vertex.erase(it);
+    }
+}
+
+/**
+ * @brief Make all vertices refer to this graph as their owner
+ *
+ */
+void ZXGraph::_rebind_vertices() {
+    for (auto& v : _vertices) v->_bookkeeping.graph = this;
+}
+
+/**
+ * @brief Add `nb` to the neighbors of `v`. Note that this only updates one side of the edge.
+ *        The statistics of the graph owning `v` are updated, which may be
+ *        another graph when two graphs are being merged.
+ *
+ * @return true if the neighbor is newly added
+ */
+bool ZXGraph::_add_neighbor(ZXVertex* v, ZXVertex* nb, EdgeType et) {
+    v->_bookkeeping.graph->_remove_from_statistics(v);
+    auto const inserted = v->_neighbors.emplace(nb, et).second;
+    v->_bookkeeping.graph->_add_to_statistics(v);
+    v->_bookkeeping.graph->_store_attributes(v);
+    v->_bookkeeping.graph->_invalidate_traversal_cache();
+    if (inserted && v->_bookkeeping.graph->_should_record()) {
+        v->_bookkeeping.graph->_journal.emplace_back(NeighborAddition{v, {nb, et}});
+    }
+    return inserted;
+}
+
+/**
+ * @brief Remove `nb` from the neighbors of `v`. Note that this only updates one side of the edge.
+ *
+ * @return size_t the number of removed neighbors
+ */
+size_t ZXGraph::_remove_neighbor(ZXVertex* v, ZXVertex* nb, EdgeType et) {
+    auto const should_record = v->_bookkeeping.graph->_should_record();
+    auto const index         = should_record ? v->_neighbors.index_of({nb, et}) : 0;
+    v->_bookkeeping.graph->_remove_from_statistics(v);
+    auto const count = v->_neighbors.erase({nb, et});
+    v->_bookkeeping.graph->_add_to_statistics(v);
+    v->_bookkeeping.graph->_store_attributes(v);
+    v->_bookkeeping.graph->_invalidate_traversal_cache();
+    if (count > 0 && should_record) {
+        v->_bookkeeping.graph->_journal.emplace_back(NeighborRemoval{v, {nb, et}, index});
+    }
+    return count;
+}
+
+/**
+ * @brief Replace all neighbors of `v`. Note that this only updates one side of the edges.
+ *
+ */
+void ZXGraph::_set_neighbors(ZXVertex* v, Neighbors const& neighbors) {
+    if (v->_bookkeeping.graph->_should_record()) {
+        v->_bookkeeping.graph->_journal.emplace_back(NeighborsReplacement{v, {v->_neighbors.begin(), v->_neighbors.end()}});
+    }
+    v->_bookkeeping.graph->_remove_from_statistics(v);
+    v->_neighbors = neighbors;
+    v->_bookkeeping.graph->_add_to_statistics(v);
+    v->_bookkeeping.graph->_store_attributes(v);
+    v->_bookkeeping.graph->_invalidate_traversal_cache();
 }
 
 /*****************************************************/
@@ -117,6 +559,14 @@ bool ZXGraph::is_valid() const {
             if (!this->is_neighbor(nb, v, etype)) return false;
         }
     }
+    if (!_check_attributes()) {
+        spdlog::debug("Error: the vertex attributes are out of sync with the graph");
+        return false;
+    }
+    if (_statistics != _scan_statistics()) {
+        spdlog::debug("Error: the graph statistics are out of sync with the graph");
+        return false;
+    }
     return true;
 }
 
@@ -128,7 +578,7 @@ bool ZXGraph::is_valid() const {
  * @return false
  */
 bool ZXGraph::is_v_id(size_t id) const {
-    return std::ranges::any_of(_vertices, [id](ZXVertex* v) { return v->get_id() == id; });
+    return find_vertex_by_id(id) != nullptr;
 }
 
 /**
@@ -138,12 +588,16 @@ bool ZXGraph::is_v_id(size_t id) const {
  * @return false
  */
 bool ZXGraph::is_graph_like() const {
+    // all vertices are Z-spiders or boundaries
+    auto const& types = _attributes.types;
+    if (auto const it = std::ranges::find_if(types, [](VertexType vt) { return vt != VertexType::z && vt != VertexType::boundary; });
+        it != types.end()) {
+        auto const v = _attributes.vertices[gsl::narrow<size_t>(it - types.begin())];
+        spdlog::debug("Note: vertex {} is of type {}", v->get_id(), v->get_type());
+        return false;
+    }
     // all internal edges are hadamard edges
     for (auto const& v : _vertices) {
-        if (!v->is_z() && !v->is_boundary()) {
-            spdlog::debug("Note: vertex {} is of type {}", v->get_id(), v->get_type());
-            return false;
-        }
         for (auto const& [nb, etype] : this->get_neighbors(v)) {
             if (v->is_boundary() || nb->is_boundary()) continue;
             if (etype != EdgeType::hadamard) {
@@ -184,9 +638,8 @@ bool ZXGraph::is_identity() const {
 }
 
 size_t ZXGraph::get_num_gadgets() const {
-    return std::ranges::count_if(_vertices, [this](ZXVertex* v) {
-        return !v->is_boundary() && this->get_num_neighbors(v) == 1;
-    });
+    _check_statistics();
+    return _statistics.num_gadgets;
 }
 
 /**
@@ -194,11 +647,9 @@ size_t ZXGraph::get_num_gadgets() const {
  *
  * @return double
  */
-double ZXGraph::density() {
-    return std::accumulate(this->get_vertices().begin(), this->get_vertices().end(), 0,
-                           [this](double sum, ZXVertex* v) {
-                               return sum + std::pow(this->get_num_neighbors(v), 2);
-                           }) /
+double ZXGraph::density() const {
+    _check_statistics();
+    return gsl::narrow_cast<double>(_statistics.sum_of_squared_degrees) /
            gsl::narrow_cast<double>(this->get_num_vertices());
 }
 
@@ -246,8 +697,14 @@ ZXVertex* ZXGraph::add_output(QubitIdType qubit, ColumnIdType col) {
  * @return ZXVertex*
  */
 ZXVertex* ZXGraph::add_vertex(QubitIdType qubit, VertexType vt, Phase phase, ColumnIdType col) {
-    auto v = new ZXVertex(_next_v_id, qubit, vt, phase, col);
+    auto v                = _vertex_pool.create(_next_v_id, qubit, vt, phase, col);
+    v->_bookkeeping.graph = this;
     _vertices.emplace(v);
+    _index_vertex(v);
+    _append_attributes(v);
+    _add_to_statistics(v);
+    _invalidate_traversal_cache();
+    if (_should_record()) _journal.emplace_back(VertexAddition{v});
     _next_v_id++;
     return v;
 }
@@ -280,10 +737,10 @@ void ZXGraph::add_edge(ZXVertex* vs, ZXVertex* vt, EdgeType et) {
                 et == EdgeType::hadamard ? VertexType::h_box : VertexType::z,
                 et == EdgeType::hadamard ? Phase(1) : Phase(0),
                 (vs->get_col() + vt->get_col()) / 2);
-            vs->_neighbors.emplace(v, EdgeType::simple);
-            v->_neighbors.emplace(vs, EdgeType::simple);
-            vt->_neighbors.emplace(v, EdgeType::simple);
-            v->_neighbors.emplace(vt, EdgeType::simple);
+            _add_neighbor(vs, v, EdgeType::simple);
+            _add_neighbor(v, vs, EdgeType::simple);
+            _add_neighbor(vt, v, EdgeType::simple);
+            _add_neighbor(v, vt, EdgeType::simple);
 
             return;
         }
@@ -294,26 +751,204 @@ void ZXGraph::add_edge(ZXVertex* vs, ZXVertex* vt, EdgeType et) {
             (vs->is_x() && vt->is_z() && et == EdgeType::simple) ||
             (vs->is_z() && vt->is_z() && et == EdgeType::hadamard) ||
             (vs->is_x() && vt->is_x() && et == EdgeType::hadamard)) {
-            vs->_neighbors.erase({vt, et});
-            vt->_neighbors.erase({vs, et});
+            _remove_neighbor(vs, vt, et);
+            _remove_neighbor(vt, vs, et);
         }  // else do nothing
 
         return;
     }
 
-    vs->_neighbors.emplace(vt, et);
-    vt->_neighbors.emplace(vs, et);
+    _add_neighbor(vs, vt, et);
+    _add_neighbor(vt, vs, et);
 
     return;
 }
 
+/**
+ * @brief Add each edge in `epairs` as if by calling `ZXGraph::add_edge` in order. When all of them
+ *        are Hadamard edges between distinct Z-spiders, as with pivoting and local complementation,
+ *        adding an edge toggles it, and the neighbors of different vertices are toggled in parallel.
+ *
+ * @param epairs
+ */
+void ZXGraph::add_edges(std::span<EdgePair const> epairs) {
+    auto const is_hadamard_between_z_spiders = [](EdgePair const& epair) {
+        auto const [vs, vt] = epair.first;
+        return epair.second == EdgeType::hadamard && vs != vt && vs->is_z() && vt->is_z();
+    };
+    constexpr size_t min_parallel_size = 4096;
+    if (epairs.size() < min_parallel_size || !std::ranges::all_of(epairs, is_hadamard_between_z_spiders)) {
+        for (auto const& [vertices, etype] : epairs) add_edge(vertices.first, vertices.second, etype);
+        return;
+    }
+
+    // group the toggles by vertex, keeping their order, so that each neighbor set ends up the same
+    constexpr auto no_group = std::numeric_limits<size_t>::max();
+    std::vector<size_t> group_of(_attributes.size(), no_group);
+    std::vector<ZXVertex*> group_vertices;
+    std::vector<std::vector<ZXVertex*>> toggled_neighbors;
+    auto const add_toggle = [&](ZXVertex* v, ZXVertex* nb) {
+        if (group_of[v->_bookkeeping.slot] == no_group) {
+            group_of[v->_bookkeeping.slot] = group_vertices.size();
+            group_vertices.emplace_back(v);
+            toggled_neighbors.emplace_back();
+        }
+        toggled_neighbors[group_of[v->_bookkeeping.slot]].emplace_back(nb);
+    };
+    for (auto const& [vertices, _] : epairs) {
+        add_toggle(vertices.first, vertices.second);
+        add_toggle(vertices.second, vertices.first);
+    }
+
+    for (auto const& v : group_vertices) _remove_from_statistics(v);
+
+    auto const should_record = _should_record();
+    std::vector<std::vector<JournalEntry>> journals(should_record ? group_vertices.size() : 0);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < group_vertices.size(); ++i) {
+        auto const v = group_vertices[i];
+        for (auto const& nb : toggled_neighbors[i]) {
+            NeighborPair const neighbor{nb, EdgeType::hadamard};
+            if (!v->_neighbors.contains(neighbor)) {
+                v->_neighbors.insert(neighbor);
+                if (should_record) journals[i].emplace_back(NeighborAddition{v, neighbor});
+            } else {
+                auto const index = should_record ? v->_neighbors.index_of(neighbor) : 0;
+                v->_neighbors.erase(neighbor);
+                if (should_record) journals[i].emplace_back(NeighborRemoval{v, neighbor, index});
+            }
+        }
+    }
+
+    for (auto const& [i, v] : tl::views::enumerate(group_vertices)) {
+        _add_to_statistics(v);
+        _store_attributes(v);
+        // the entries of different vertices commute, so they can be undone vertex by vertex
+        if (should_record) _journal.insert(_journal.end(), journals[i].begin(), journals[i].end());
+    }
+    _invalidate_traversal_cache();
+}
+
+/**
+ * @brief Toggle the Hadamard edge between every two of `vertices` in different parts, where `parts[i]`
+ *        is the part of `vertices[i]` and the vertices of each part are consecutive. This is the same
+ *        as calling `ZXGraph::add_edge` on each such pair (i, j), i < j, in order. When the vertices are
+ *        distinct Z-spiders, the present neighbors of each vertex are collected into a bitset over the
+ *        indices, the complement is taken word by word, and each neighbor set is rebuilt in one pass
+ *        instead of hashing the quadratically many edges one by one. The surviving neighbors keep
+ *        their order and the new ones are appended in the order of the pairs, as with `add_edge`.
+ *
+ * @param vertices
+ * @param parts
+ */
+void ZXGraph::complement_hadamard_edges(std::span<ZXVertex* const> vertices, std::span<size_t const> parts) {
+    assert(vertices.size() == parts.size());
+    auto const n = vertices.size();
+
+    // reserve a range of fresh marks so that the mark of each vertex also tells its index
+    auto const base_mark = _new_traversal_marks(n);
+    auto const index_of  = [&](ZXVertex* v) -> size_t {
+        auto const mark = v->_bookkeeping.traversal_mark;
+        return mark >= base_mark && mark - base_mark < n ? mark - base_mark : n;
+    };
+
+    bool are_distinct_z_spiders = true;
+    for (auto const& [i, v] : tl::views::enumerate(vertices)) {
+        if (!v->is_z() || index_of(v) != n) {
+            are_distinct_z_spiders = false;
+            break;
+        }
+        v->_bookkeeping.traversal_mark = base_mark + static_cast<ZXVertex::Mark>(i);
+    }
+    if (!are_distinct_z_spiders) {
+        std::vector<EdgePair> epairs;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                if (parts[i] != parts[j]) epairs.emplace_back(std::make_pair(vertices[i], vertices[j]), EdgeType::hadamard);
+            }
+        }
+        add_edges(epairs);
+        return;
+    }
+
+    // the range of indices in the part of each vertex
+    std::vector<size_t> part_begin(n), part_end(n);
+    for (size_t i = 0; i < n; ++i) {
+        part_begin[i] = (i > 0 && parts[i] == parts[i - 1]) ? part_begin[i - 1] : i;
+    }
+    for (size_t i = n; i-- > 0;) {
+        part_end[i] = (i + 1 < n && parts[i] == parts[i + 1]) ? part_end[i + 1] : i + 1;
+    }
+
+    for (auto const& v : vertices) _remove_from_statistics(v);
+
+    auto const should_record = _should_record();
+    std::vector<NeighborsReplacement> journals(should_record ? n : 0);
+    auto const num_words = (n + 63) / 64;
+
+    constexpr size_t min_parallel_size = 256;
+#pragma omp parallel for schedule(dynamic, 16) if (n >= min_parallel_size)
+    for (size_t i = 0; i < n; ++i) {
+        auto const v = vertices[i];
+        std::vector<uint64_t> is_present(num_words, 0);
+        std::vector<NeighborPair> new_neighbors;
+        new_neighbors.reserve(v->_neighbors.size() + n);
+        for (auto const& [nb, etype] : v->_neighbors) {
+            auto const j = etype == EdgeType::hadamard ? index_of(nb) : n;
+            if (j < part_begin[i] || (j >= part_end[i] && j < n)) {
+                is_present[j / 64] |= uint64_t{1} << (j % 64);
+            } else {
+                new_neighbors.emplace_back(nb, etype);
+            }
+        }
+        for (size_t w = 0; w < num_words; ++w) {
+            // the indices of the other parts, less the present ones
+            auto const word_begin = w * 64;
+            // the bits of this word with an index less than `j`
+            auto const bits_below = [word_begin](size_t j) {
+                if (j <= word_begin) return uint64_t{0};
+                if (j >= word_begin + 64) return ~uint64_t{0};
+                return (uint64_t{1} << (j - word_begin)) - 1;
+            };
+            auto const own_part = bits_below(part_end[i]) & ~bits_below(part_begin[i]);
+            auto to_add         = bits_below(n) & ~own_part & ~is_present[w];
+            while (to_add != 0) {
+                new_neighbors.emplace_back(vertices[word_begin + std::countr_zero(to_add)], EdgeType::hadamard);
+                to_add &= to_add - 1;
+            }
+        }
+        if (should_record) journals[i] = {v, {v->_neighbors.begin(), v->_neighbors.end()}};
+        v->_neighbors.assign_unique(new_neighbors.begin(), new_neighbors.end());
+    }
+
+    for (auto const& [i, v] : tl::views::enumerate(vertices)) {
+        _add_to_statistics(v);
+        _store_attributes(v);
+        // the replacements of different vertices commute
+        if (should_record) _journal.emplace_back(std::move(journals[i]));
+    }
+    _invalidate_traversal_cache();
+}
+
 /**
  * @brief Move vertices from the other graph
  *
  * @param vertices
  */
 void ZXGraph::_move_vertices_from(ZXGraph& other) {
+    _vertex_pool.adopt(std::move(other._vertex_pool));
     _vertices.insert(other._vertices.begin(), other._vertices.end());
+    for (auto& v : other._vertices) {
+        v->_bookkeeping.traversal_mark = 0;  // the marks are only meaningful to the graph that set them
+        v->_bookkeeping.change_mark    = 0;
+        v->_bookkeeping.gadget_mark    = 0;
+        _add_to_statistics(v);
+        _append_attributes(v);
+    }
+    _invalidate_traversal_cache();
+    this->_rebind_vertices();
+    // the vertices are now owned by this graph, so relabeling them also indexes them here
     other.relabel_vertex_ids(_next_v_id);
     _next_v_id += other.get_num_vertices();
 
@@ -322,6 +957,12 @@ void ZXGraph::_move_vertices_from(ZXGraph& other) {
     other._outputs.clear();
     other._input_list.clear();
     other._output_list.clear();
+    other._id_to_vertex.clear();
+    other._sparse_id_to_vertex.clear();
+    other._statistics = {};
+    other._attributes   = {};
+    other._gadget_index = {};
+    other._invalidate_traversal_cache();
 }
 
 /*****************************************************/
@@ -350,12 +991,24 @@ size_t ZXGraph::remove_vertex(ZXVertex* v) {
 
     auto v_neighbors = this->get_neighbors(v);
     for (auto const& n : v_neighbors) {
-        v->_neighbors.erase(n);
         ZXVertex* const nv = n.first;
         EdgeType const ne  = n.second;
-        nv->_neighbors.erase({v, ne});
+        _remove_neighbor(v, nv, ne);
+        _remove_neighbor(nv, v, ne);
+    }
+    if (_should_record()) {
+        _journal.emplace_back(VertexRemoval{
+            v,
+            _vertices.id(v),
+            _inputs.contains(v) ? std::make_optional(_inputs.id(v)) : std::nullopt,
+            _outputs.contains(v) ? std::make_optional(_outputs.id(v)) : std::nullopt});
     }
     _vertices.erase(v);
+    _unindex_vertex(v);
+    _remove_from_statistics(v);
+    _clear_attributes(v->_bookkeeping.slot);
+    _compact_attributes();
+    _invalidate_traversal_cache();
 
     // Check if also in _inputs or _outputs
     if (_inputs.contains(v)) {
@@ -367,8 +1020,8 @@ size_t ZXGraph::remove_vertex(ZXVertex* v) {
         _outputs.erase(v);
     }
 
-    // deallocate ZXVertex
-    delete v;
+    // deallocate ZXVertex, unless the removal may be rolled back
+    if (!is_journaling()) _vertex_pool.destroy(v);
     return 1;
 }
 
@@ -401,7 +1054,7 @@ size_t ZXGraph::remove_edge(EdgePair const& ep) {
  * @param etype
  */
 size_t ZXGraph::remove_edge(ZXVertex* vs, ZXVertex* vt, EdgeType etype) {
-    auto const count = vs->_neighbors.erase({vt, etype}) + vt->_neighbors.erase({vs, etype});
+    auto const count = _remove_neighbor(vs, vt, etype) + _remove_neighbor(vt, vs, etype);
     if (count == 1) {
         throw std::out_of_range("Graph connection error in " + std::to_string(vs->get_id()) + " and " + std::to_string(vt->get_id()));
     }
@@ -443,6 +1096,7 @@ size_t ZXGraph::remove_all_edges_between(ZXVertex* vs, ZXVertex* vt) {
 void ZXGraph::adjoint() {
     std::swap(_inputs, _outputs);
     std::swap(_input_list, _output_list);
+    _invalidate_traversal_cache();
     auto max_col = std::ranges::max(_vertices | std::views::transform([](ZXVertex* v) { return v->get_col(); }));
 
     std::ranges::for_each(_vertices, [&max_col](ZXVertex* v) {
@@ -520,8 +1174,9 @@ ZXVertex* ZXGraph::add_buffer(ZXVertex* vertex_to_protect, ZXVertex* vertex_othe
  * @return ZXVertex*
  */
 ZXVertex* ZXGraph::find_vertex_by_id(size_t const& id) const {
-    auto it = std::ranges::find_if(_vertices, [id](ZXVertex* v) { return v->get_id() == id; });
-    return it == _vertices.end() ? nullptr : *it;
+    if (id < _id_to_vertex.size() && _id_to_vertex[id] != nullptr) return _id_to_vertex[id];
+    auto const it = _sparse_id_to_vertex.find(id);
+    return it == _sparse_id_to_vertex.end() ? nullptr : it->second;
 }
 
 dvlab::BooleanMatrix get_biadjacency_matrix(ZXGraph const& graph, ZXVertexList const& row_vertices, ZXVertexList const& col_vertices) {
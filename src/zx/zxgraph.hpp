@@ -10,18 +10,23 @@
 #include <spdlog/spdlog.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <iterator>
 #include <limits>
+#include <optional>
 #include <span>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <variant>
+#include <vector>
 
 #include "./zx_def.hpp"
 #include "qsyn/qsyn_type.hpp"
 #include "spdlog/common.h"
 #include "util/boolean_matrix.hpp"
+#include "util/object_pool.hpp"
 #include "util/phase.hpp"
 
 namespace qsyn::zx {
@@ -61,11 +66,11 @@ public:
     VertexType get_type() const { return _type; }
     ColumnIdType get_col() const { return _col; }
 
-    void set_id(size_t id) { _id = id; }
-    void set_qubit(QubitIdType q) { _qubit = q; }
-    void set_phase(Phase const& p) { _phase = p; }
-    void set_col(ColumnIdType c) { _col = c; }
-    void set_type(VertexType vt) { _type = vt; }
+    void set_id(size_t id);
+    void set_qubit(QubitIdType q);
+    void set_phase(Phase const& p);
+    void set_col(ColumnIdType c);
+    void set_type(VertexType vt);
 
     // Print functions
     void print_vertex(spdlog::level::level_enum lvl = spdlog::level::level_enum::off) const;
@@ -87,6 +92,18 @@ private:
     Phase _phase;
     ColumnIdType _col;
     Neighbors _neighbors;
+
+    // Kept by the graph owning this vertex. The marks are 32-bit and the graph resets them before
+    // its mark counter wraps around, see ZXGraph::_new_traversal_marks
+    using Mark = std::uint32_t;
+    struct Bookkeeping {
+        ZXGraph* graph      = nullptr;  // notified of changes to the attributes
+        std::uint32_t slot  = 0;        // the index of this vertex in the attribute arrays of the graph
+        Mark traversal_mark = 0;        // visited in the traversal with the same mark
+        Mark change_mark    = 0;        // already recorded as changed if equal to the change mark of the graph
+        Mark gadget_mark    = 0;        // already recorded as changed if equal to the mark of the gadget index
+    };
+    Bookkeeping _bookkeeping;
 };
 
 class ZXGraph {  // NOLINT(cppcoreguidelines-special-member-functions) : copy-swap idiom
@@ -94,39 +111,48 @@ public:
     using QubitIdType  = ZXVertex::QubitIdType;
     using ColumnIdType = ZXVertex::ColumnIdType;
 
+    // A structure-of-arrays mirror of the vertex attributes, in the same order as `get_vertices()`,
+    // so that whole-graph scans can run over contiguous arrays instead of chasing vertex pointers.
+    // The slots of removed vertices hold a null vertex and attributes that no scan counts,
+    // i.e., those of a boundary vertex with zero phase and no neighbors.
+    struct VertexAttributes {
+        std::vector<ZXVertex*> vertices;
+        std::vector<VertexType> types;
+        std::vector<Phase::IntegralType> phase_numerators;
+        std::vector<Phase::IntegralType> phase_denominators;
+        std::vector<QubitIdType> qubits;
+        std::vector<ColumnIdType> cols;
+        std::vector<size_t> degrees;
+
+        size_t size() const { return vertices.size(); }
+    };
+
     ZXGraph() {}
 
     ~ZXGraph() {
+        // the pool returns all of its chunks at once, so there is no need to recycle the slots one by one
         for (auto& v : _vertices) {
-            delete v;
+            dvlab::utils::ObjectPool<ZXVertex>::destroy_unrecycled(v);
+        }
+        // vertices removed under an uncommitted checkpoint are still alive
+        for (auto& entry : _journal) {
+            if (auto const removal = std::get_if<VertexRemoval>(&entry)) {
+                dvlab::utils::ObjectPool<ZXVertex>::destroy_unrecycled(removal->vertex);
+            }
         }
     }
 
     ZXGraph(ZXGraph const& other);
 
-    ZXGraph(ZXGraph&& other) noexcept = default;
-
-    ZXGraph(ZXVertexList const& vertices,
-            ZXVertexList const& inputs,
-            ZXVertexList const& outputs);
+    ZXGraph(ZXGraph&& other) noexcept { swap(other); }
 
     ZXGraph& operator=(ZXGraph copy) {
         copy.swap(*this);
         return *this;
     }
 
-    void release() {
-        _next_v_id = 0;
-        _filename  = "";
-        _procedures.clear();
-        _inputs.clear();
-        _outputs.clear();
-        _vertices.clear();
-        _input_list.clear();
-        _output_list.clear();
-    }
-
     void swap(ZXGraph& other) noexcept {
+        std::swap(_vertex_pool, other._vertex_pool);
         std::swap(_next_v_id, other._next_v_id);
         std::swap(_filename, other._filename);
         std::swap(_procedures, other._procedures);
@@ -135,6 +161,21 @@ public:
         std::swap(_vertices, other._vertices);
         std::swap(_input_list, other._input_list);
         std::swap(_output_list, other._output_list);
+        std::swap(_statistics, other._statistics);
+        std::swap(_attributes, other._attributes);
+        std::swap(_is_tracking_changes, other._is_tracking_changes);
+        std::swap(_change_mark, other._change_mark);
+        std::swap(_changed_vertex_ids, other._changed_vertex_ids);
+        std::swap(_gadget_index, other._gadget_index);
+        std::swap(_id_to_vertex, other._id_to_vertex);
+        std::swap(_sparse_id_to_vertex, other._sparse_id_to_vertex);
+        std::swap(_journal, other._journal);
+        std::swap(_checkpoints, other._checkpoints);
+        std::swap(_is_rolling_back, other._is_rolling_back);
+        std::swap(_global_traversal_counter, other._global_traversal_counter);
+        std::swap(_topological_order, other._topological_order);
+        this->_rebind_vertices();
+        other._rebind_vertices();
     }
 
     friend void swap(ZXGraph& a, ZXGraph& b) noexcept {
@@ -143,8 +184,14 @@ public:
 
     // Getter and Setter
 
-    void set_inputs(ZXVertexList const& inputs) { _inputs = inputs; }
-    void set_outputs(ZXVertexList const& outputs) { _outputs = outputs; }
+    void set_inputs(ZXVertexList const& inputs) {
+        _inputs = inputs;
+        _invalidate_traversal_cache();
+    }
+    void set_outputs(ZXVertexList const& outputs) {
+        _outputs = outputs;
+        _invalidate_traversal_cache();
+    }
     void set_filename(std::string const& f) { _filename = f; }
     void add_procedures(std::vector<std::string> const& ps) { _procedures.insert(std::end(_procedures), std::begin(ps), std::end(ps)); }
     void add_procedure(std::string_view p) { _procedures.emplace_back(p); }
@@ -153,12 +200,16 @@ public:
     ZXVertexList const& get_inputs() const { return _inputs; }
     ZXVertexList const& get_outputs() const { return _outputs; }
     ZXVertexList const& get_vertices() const { return _vertices; }
-    size_t get_num_edges() const;
+    size_t get_num_edges() const {
+        _check_statistics();
+        return _statistics.sum_of_degrees / 2;
+    }
     size_t get_num_inputs() const { return _inputs.size(); }
     size_t get_num_outputs() const { return _outputs.size(); }
     size_t get_num_vertices() const { return _vertices.size(); }
 
     Neighbors const& get_neighbors(ZXVertex* v) const { return v->_neighbors; }
+    VertexAttributes const& get_vertex_attributes() const { return _attributes; }
     size_t get_num_neighbors(ZXVertex* v) const { return v->_neighbors.size(); }
     NeighborPair const& get_first_neighbor(ZXVertex* v) const { return *(std::begin(v->_neighbors)); }
     NeighborPair const& get_second_neighbor(ZXVertex* v) const { return *(std::next(std::begin(v->_neighbors))); }
@@ -185,12 +236,23 @@ public:
     bool is_gadget_axel(ZXVertex*) const;
     bool has_dangling_neighbors(ZXVertex*) const;
 
-    double density();
+    // Phase gadgets, indexed incrementally. The leaves are the non-boundary vertices with exactly one
+    // neighbor, their axel; the conditions on the types and the phases are up to the caller. The index
+    // is brought up to date only by `update_gadget_index`, which must be called after mutating the
+    // graph and before the queries, so that the queries only read and can run concurrently
+    void update_gadget_index();
+    std::vector<ZXVertex*> get_gadget_leaves() const;
+    size_t get_num_gadget_leaves(ZXVertex* axel) const;
+    size_t get_gadget_group_signature(ZXVertex* leaf) const;
+
+    double density() const;
     inline size_t t_count() const {
-        return std::ranges::count_if(_vertices, [](ZXVertex* v) { return (v->get_phase().denominator() == 4); });
+        _check_statistics();
+        return _statistics.num_t_vertices;
     }
     inline size_t non_clifford_count() const {
-        return std::ranges::count_if(_vertices, [](ZXVertex* v) { return !v->is_clifford(); });
+        _check_statistics();
+        return _statistics.num_non_clifford_vertices;
     }
     inline size_t non_clifford_t_count() const { return non_clifford_count() - t_count(); }
 
@@ -199,6 +261,8 @@ public:
     ZXVertex* add_output(QubitIdType qubit, ColumnIdType col = 0);
     ZXVertex* add_vertex(QubitIdType qubit, VertexType vt, Phase phase = Phase(), ColumnIdType col = 0);
     void add_edge(ZXVertex* vs, ZXVertex* vt, EdgeType et);
+    void add_edges(std::span<EdgePair const> epairs);
+    void complement_hadamard_edges(std::span<ZXVertex* const> vertices, std::span<size_t const> parts);
 
     size_t remove_isolated_vertices();
     size_t remove_vertex(ZXVertex* v);
@@ -234,6 +298,18 @@ public:
     std::unordered_map<size_t, ZXVertex*> create_id_to_vertex_map() const;
     void normalize();
 
+    // Journal (in zx_journal.cpp)
+    void checkpoint();
+    void rollback();
+    void commit();
+    bool is_journaling() const { return !_checkpoints.empty(); }
+
+    // Change tracking, so that rewrite rules can be matched around the changed vertices only
+    void start_tracking_changes();
+    void stop_tracking_changes();
+    bool is_tracking_changes() const { return _is_tracking_changes; }
+    std::optional<std::vector<ZXVertex*>> take_changed_neighborhood(size_t max_size);
+
     // Print functions (zxGraphPrint.cpp)
     void print_graph(spdlog::level::level_enum lvl = spdlog::level::level_enum::off) const;
     void print_inputs() const;
@@ -269,11 +345,12 @@ public:
     std::vector<ZXVertex*> create_breadth_level() const;
     template <typename F>
     void topological_traverse(F lambda) {
+        // iterate over a copy, as `lambda` may modify the graph and thus invalidate the cached order
         std::ranges::for_each(create_topological_order(), lambda);
     }
     template <typename F>
     void topological_traverse(F lambda) const {
-        std::ranges::for_each(create_topological_order(), lambda);
+        std::ranges::for_each(_get_topological_order(), lambda);
     }
     template <typename F>
     void for_each_edge(F lambda) const {
@@ -285,11 +362,26 @@ public:
         }
     }
 
+    // visit each edge with at least one endpoint in `vertices` once
+    template <typename F>
+    void for_each_incident_edge(std::span<ZXVertex* const> vertices, F lambda) const {
+        auto const mark = _new_traversal_mark();
+        for (auto& v : vertices) v->_bookkeeping.traversal_mark = mark;
+        for (auto& v : vertices) {
+            for (auto& [nb, etype] : this->get_neighbors(v)) {
+                if (nb->get_id() > v->get_id() || nb->_bookkeeping.traversal_mark != mark)
+                    lambda(make_edge_pair(v, nb, etype));
+            }
+        }
+    }
+
     // divide into subgraphs and merge (in zxPartition.cpp)
-    std::pair<std::vector<ZXGraph*>, std::vector<ZXCut>> create_subgraphs(std::vector<ZXVertexList> partitions);
-    static ZXGraph* from_subgraphs(std::vector<ZXGraph*> const& subgraphs, std::vector<ZXCut> const& cuts);
+    std::pair<std::vector<ZXGraph*>, std::vector<ZXCut>> create_subgraphs(std::vector<ZXVertexList> const& partitions) const;
+    static ZXGraph* from_subgraphs(std::vector<ZXGraph*> const& subgraphs, std::vector<ZXCut> const& cuts, ZXVertexList* cut_vertices = nullptr);
 
 private:
+    // declared first so that it outlives all containers referring to the vertices
+    dvlab::utils::ObjectPool<ZXVertex> _vertex_pool;
     size_t _next_v_id = 0;
     std::string _filename;
     std::vector<std::string> _procedures;
@@ -299,14 +391,194 @@ private:
     std::unordered_map<size_t, ZXVertex*> _input_list;
     std::unordered_map<size_t, ZXVertex*> _output_list;
 
-    void _dfs(std::unordered_set<ZXVertex*>& visited_vertices, std::vector<ZXVertex*>& topological_order, ZXVertex* v) const;
-    void _bfs(std::unordered_set<ZXVertex*>& visited_vertices, std::vector<ZXVertex*>& topological_order, ZXVertex* v) const;
+    // maintained on every mutation so that the queries are O(1)
+    struct Statistics {
+        size_t num_t_vertices            = 0;
+        size_t num_non_clifford_vertices = 0;
+        size_t num_gadgets               = 0;  // non-boundary vertices with exactly one neighbor
+        size_t sum_of_degrees            = 0;
+        size_t sum_of_squared_degrees    = 0;
+        bool operator==(Statistics const&) const = default;
+    } _statistics;
+
+    // the vertices indexed by their ids. Ids far beyond the number of vertices,
+    // e.g., ones kept from a file, are put in the sparse map instead
+    std::vector<ZXVertex*> _id_to_vertex;
+    std::unordered_map<size_t, ZXVertex*> _sparse_id_to_vertex;
+
+    VertexAttributes _attributes;
+
+    // the ids of the vertices whose attributes changed since the last `take_changed_neighborhood`,
+    // possibly already removed. Each vertex is recorded once per change mark.
+    bool _is_tracking_changes = false;
+    ZXVertex::Mark mutable _change_mark = 0;
+    std::vector<size_t> _changed_vertex_ids;
+
+    // brought up to date with the vertices changed or removed since the last update, see
+    // `update_gadget_index`. Keyed by the vertices rather than their ids, which may change
+    struct GadgetIndex {
+        struct Axel {
+            size_t num_leaves         = 0;
+            size_t neighbor_signature = 0;  // the sum of the signatures of the neighbors
+        };
+        bool is_built = false;
+        ZXVertex::Mark mutable mark = 0;
+        std::vector<ZXVertex*> changed_vertices;  // possibly already removed
+        std::unordered_map<ZXVertex*, ZXVertex*> axel_of_leaf;
+        std::unordered_map<ZXVertex*, Axel> axels;
+    };
+    GadgetIndex _gadget_index;
+
+    friend class ZXVertex;
+    void _append_attributes(ZXVertex* v);
+    void _store_attributes(ZXVertex* v);
+    void _clear_attributes(size_t slot);
+    void _compact_attributes();
+    bool _check_attributes() const;
+    void _record_gadget_change(ZXVertex* v);
+    bool _is_gadget_index_current() const { return _gadget_index.is_built && _gadget_index.changed_vertices.empty(); }
+    void _index_vertex(ZXVertex* v);
+    void _unindex_vertex(ZXVertex const* v);
+    void _add_to_statistics(ZXVertex const* v);
+    void _remove_from_statistics(ZXVertex const* v);
+    Statistics _scan_statistics() const;
+    void _check_statistics() const;
+    void _rebind_vertices();
+
+    // the mutations recorded under a checkpoint, in the order they happened
+    struct VertexAddition {
+        ZXVertex* vertex;
+    };
+    struct VertexRemoval {
+        ZXVertex* vertex;
+        size_t vertex_id;  // the ids in the ordered hashsets, so that the vertex can be put back in place
+        std::optional<size_t> input_id;
+        std::optional<size_t> output_id;
+    };
+    struct NeighborAddition {
+        ZXVertex* vertex;
+        NeighborPair neighbor;
+    };
+    struct NeighborRemoval {
+        ZXVertex* vertex;
+        NeighborPair neighbor;
+        size_t index;  // the position among the neighbors of `vertex`
+    };
+    struct NeighborsReplacement {
+        ZXVertex* vertex;
+        std::vector<NeighborPair> neighbors;
+    };
+    struct PhaseChange {
+        ZXVertex* vertex;
+        Phase phase;
+    };
+    struct TypeChange {
+        ZXVertex* vertex;
+        VertexType type;
+    };
+    struct QubitChange {
+        ZXVertex* vertex;
+        QubitIdType qubit;
+    };
+    struct ColumnChange {
+        ZXVertex* vertex;
+        ColumnIdType col;
+    };
+    struct IdChange {
+        ZXVertex* vertex;
+        size_t id;
+    };
+    using JournalEntry = std::variant<VertexAddition, VertexRemoval, NeighborAddition, NeighborRemoval, NeighborsReplacement,
+                                      PhaseChange, TypeChange, QubitChange, ColumnChange, IdChange>;
+
+    struct Checkpoint {
+        size_t journal_size;
+        size_t next_v_id;
+    };
+
+    std::vector<JournalEntry> _journal;
+    std::vector<Checkpoint> _checkpoints;
+    bool _is_rolling_back = false;
+
+    bool _should_record() const { return is_journaling() && !_is_rolling_back; }
+    void _undo(JournalEntry const& entry);
+
+    static bool _add_neighbor(ZXVertex* v, ZXVertex* nb, EdgeType et);
+    static size_t _remove_neighbor(ZXVertex* v, ZXVertex* nb, EdgeType et);
+    static void _set_neighbors(ZXVertex* v, Neighbors const& neighbors);
+
+    // cached until the connectivity or the boundaries of the graph change
+    std::optional<std::vector<ZXVertex*>> mutable _topological_order;
+    ZXVertex::Mark mutable _global_traversal_counter = 0;
+
+    void _invalidate_traversal_cache() { _topological_order.reset(); }
+    ZXVertex::Mark _new_traversal_marks(size_t n) const;
+    ZXVertex::Mark _new_traversal_mark() const { return _new_traversal_marks(1); }
+    void _reset_marks() const;
+    std::vector<ZXVertex*> const& _get_topological_order() const;
+    void _dfs(ZXVertex::Mark mark, std::vector<ZXVertex*>& topological_order, ZXVertex* v) const;
+    void _bfs(ZXVertex::Mark mark, std::vector<ZXVertex*>& breadth_order, ZXVertex* v) const;
 
     bool _build_graph_from_parser_storage(detail::StorageType const& storage, bool keep_id = false);
 
     void _move_vertices_from(ZXGraph& other);
 };
 
+inline void ZXVertex::set_id(size_t id) {
+    if (_bookkeeping.graph == nullptr) {
+        _id = id;
+        return;
+    }
+    if (_bookkeeping.graph->_should_record()) _bookkeeping.graph->_journal.emplace_back(ZXGraph::IdChange{this, _id});
+    _bookkeeping.graph->_unindex_vertex(this);
+    _id = id;
+    _bookkeeping.graph->_index_vertex(this);
+}
+
+inline void ZXVertex::set_qubit(QubitIdType q) {
+    if (_bookkeeping.graph == nullptr) {
+        _qubit = q;
+        return;
+    }
+    if (_bookkeeping.graph->_should_record()) _bookkeeping.graph->_journal.emplace_back(ZXGraph::QubitChange{this, _qubit});
+    _qubit = q;
+    _bookkeeping.graph->_store_attributes(this);
+}
+
+inline void ZXVertex::set_phase(Phase const& p) {
+    if (_bookkeeping.graph == nullptr) {
+        _phase = p;
+        return;
+    }
+    if (_bookkeeping.graph->_should_record()) _bookkeeping.graph->_journal.emplace_back(ZXGraph::PhaseChange{this, _phase});
+    _bookkeeping.graph->_remove_from_statistics(this);
+    _phase = p;
+    _bookkeeping.graph->_add_to_statistics(this);
+    _bookkeeping.graph->_store_attributes(this);
+}
+
+inline void ZXVertex::set_col(ColumnIdType c) {
+    if (_bookkeeping.graph == nullptr) {
+        _col = c;
+        return;
+    }
+    if (_bookkeeping.graph->_should_record()) _bookkeeping.graph->_journal.emplace_back(ZXGraph::ColumnChange{this, _col});
+    _col = c;
+    _bookkeeping.graph->_store_attributes(this);
+}
+
+inline void ZXVertex::set_type(VertexType vt) {
+    if (_bookkeeping.graph == nullptr) {
+        _type = vt;
+        return;
+    }
+    if (_bookkeeping.graph->_should_record()) _bookkeeping.graph->_journal.emplace_back(ZXGraph::TypeChange{this, _type});
+    _bookkeeping.graph->_remove_from_statistics(this);
+    _type = vt;
+    _bookkeeping.graph->_add_to_statistics(this);
+    _bookkeeping.graph->_store_attributes(this);
+}
+
 dvlab::BooleanMatrix get_biadjacency_matrix(ZXGraph const& graph, ZXVertexList const& row_vertices, ZXVertexList const& col_vertices);
 
 }  // namespace qsyn::zx
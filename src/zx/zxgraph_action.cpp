@@ -22,6 +22,7 @@ namespace qsyn::zx {
 void ZXGraph::sort_io_by_qubit() {
     _inputs.sort([](ZXVertex* a, ZXVertex* b) { return a->get_qubit() < b->get_qubit(); });
     _outputs.sort([](ZXVertex* a, ZXVertex* b) { return a->get_qubit() < b->get_qubit(); });
+    _invalidate_traversal_cache();
 }
 
 /**
@@ -35,10 +36,10 @@ void ZXGraph::toggle_vertex(ZXVertex* v) {
     Neighbors toggled_neighbors;
     for (auto& [nb, etype] : this->get_neighbors(v)) {
         toggled_neighbors.emplace(nb, toggle_edge(etype));
-        nb->_neighbors.erase({v, etype});
-        nb->_neighbors.emplace(v, toggle_edge(etype));
+        _remove_neighbor(nb, v, etype);
+        _add_neighbor(nb, v, toggle_edge(etype));
     }
-    v->_neighbors = toggled_neighbors;
+    _set_neighbors(v, toggled_neighbors);
     v->set_type(v->get_type() == VertexType::z ? VertexType::x : VertexType::z);
 }
 
@@ -170,7 +171,8 @@ bool ZXGraph::is_gadget_leaf(ZXVertex* v) const {
 }
 
 /**
- * @brief Check if v is a gadget axel
+ * @brief Check if v is a gadget axel. The gadget index must be up to date; it rules out the
+ *        vertices without leaves before their neighbors are visited.
  *
  * @param v
  * @return true
@@ -179,6 +181,7 @@ bool ZXGraph::is_gadget_leaf(ZXVertex* v) const {
 bool ZXGraph::is_gadget_axel(ZXVertex* v) const {
     return v->is_z() &&
            v->has_n_pi_phase() &&
+           get_num_gadget_leaves(v) > 0 &&
            std::ranges::any_of(this->get_neighbors(v),
                                [this](NeighborPair const& nbp) {
                                    return this->get_num_neighbors(nbp.first) == 1 && nbp.first->is_z() && nbp.second == EdgeType::hadamard;
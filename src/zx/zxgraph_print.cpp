@@ -75,11 +75,9 @@ void ZXGraph::print_vertices(spdlog::level::level_enum lvl) const {
  * @param cand
  */
 void ZXGraph::print_vertices(std::vector<size_t> cand) const {
-    std::unordered_map<size_t, ZXVertex*> id2_vmap = create_id_to_vertex_map();
-
     fmt::println("");
     for (size_t i = 0; i < cand.size(); i++) {
-        if (is_v_id(cand[i])) id2_vmap[cand[i]]->print_vertex();
+        if (auto const v = find_vertex_by_id(cand[i])) v->print_vertex();
     }
     fmt::println("");
 }